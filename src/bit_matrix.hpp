@@ -0,0 +1,302 @@
+#ifndef _bit_matrix_hpp_include_
+#define _bit_matrix_hpp_include_
+
+#include "core.hpp"
+
+// dst |= src, word by word. Blocks of 4 words go through the vector
+// extensions of GCC/Clang, which become SSE2/AVX ORs, other compilers get the
+// plain loop.
+inline void bit_or(x::slice<x::u64> dst, x::view<x::u64> src){
+	auto n = x::min(dst.size(), src.size());
+	auto d = dst.raw_data();
+	auto s = src.raw_data();
+
+	x::usize i = 0;
+	#if COMPILER_VENDOR_GCC || COMPILER_VENDOR_CLANG
+	typedef x::u64 block __attribute__((vector_size(32)));
+	for(; i + 4 <= n; i += 4){
+		block a, b;
+		__builtin_memcpy(&a, d + i, sizeof(block));
+		__builtin_memcpy(&b, s + i, sizeof(block));
+		a |= b;
+		__builtin_memcpy(d + i, &a, sizeof(block));
+	}
+	#endif
+	for(; i < n; i += 1){
+		d[i] |= s[i];
+	}
+}
+
+// Square matrix of bits. Every row is a run of `stride` u64 words and all rows
+// live inside of a single allocation, so scanning a row touches 1/8th of the
+// memory a slice<bool> would.
+//
+// Rows and columns are reserved ahead of time (capacity), growing the matrix
+// within its capacity only changes the count, past it the storage is
+// reallocated geometrically and the old block is released. Bits outside of
+// the count x count corner are always 0.
+struct bit_matrix {
+	static constexpr x::usize word_bits = 64;
+	// Rows are padded to a multiple of this many words, so bit_or() over
+	// whole rows never falls into its scalar tail.
+	static constexpr x::usize block_words = 4;
+
+	static constexpr
+	x::usize words_for(x::usize bits){
+		return (bits + word_bits - 1) / word_bits;
+	}
+
+	x::usize size() const {
+		return count;
+	}
+
+	x::usize capacity() const {
+		return cap;
+	}
+
+	bool get(x::usize r, x::usize c) const {
+		x::bounds_check((r < count) && (c < count));
+		auto w = words[r * stride + (c / word_bits)];
+		return (w >> (c % word_bits)) & 1;
+	}
+
+	void set(x::usize r, x::usize c, bool value){
+		x::bounds_check((r < count) && (c < count));
+		auto& w = words[r * stride + (c / word_bits)];
+		auto mask = x::u64(1) << (c % word_bits);
+		w = value ? (w | mask) : (w & ~mask);
+	}
+
+	x::slice<x::u64> row(x::usize r){
+		x::bounds_check(r < count);
+		return words.sub(r * stride, (r + 1) * stride);
+	}
+
+	x::view<x::u64> row(x::usize r) const {
+		x::bounds_check(r < count);
+		return x::view(words).sub(r * stride, (r + 1) * stride);
+	}
+
+	// Call fn(col) for every set bit of row r, in ascending order
+	template<typename Func>
+	void for_each_in_row(x::usize r, Func&& fn) const {
+		auto data = row(r);
+		for(x::usize i = 0; i < data.size(); i += 1){
+			auto w = data[i];
+			while(w != 0){
+				auto bit = x::usize(std::countr_zero(w));
+				fn(i * word_bits + bit);
+				w &= w - 1;
+			}
+		}
+	}
+
+	// Number of set bits in row r
+	x::usize count_in_row(x::usize r) const {
+		x::usize total = 0;
+		for(auto w : row(r)){
+			total += std::popcount(w);
+		}
+		return total;
+	}
+
+	// Index of the first set bit of row r at or after column `from`, -1 if
+	// there are none left.
+	x::isize next_in_row(x::usize r, x::usize from) const {
+		if(from >= count){ return -1; }
+
+		auto data = row(r);
+		auto i = from / word_bits;
+		auto w = data[i] & (~x::u64(0) << (from % word_bits));
+
+		while(1){
+			if(w != 0){
+				return x::isize(i * word_bits + std::countr_zero(w));
+			}
+			i += 1;
+			if(i >= data.size()){ break; }
+			w = data[i];
+		}
+		return -1;
+	}
+
+	void clear(){
+		if(words.empty()){ return; }
+		x::mem_set(words.raw_data(), 0, words.size() * sizeof(x::u64));
+	}
+
+	// Make room for at least n rows and columns
+	x::allocator::error reserve(x::usize n){
+		if(n <= cap){ return x::allocator::error::None; }
+
+		auto new_cap = x::max(n, cap * 2, word_bits);
+		auto new_stride = x::align_forward(words_for(new_cap), block_words);
+
+		auto [new_words, err] = x::make_slice_checked<x::u64>(backing_allocator, new_cap * new_stride);
+		Or_Return(err);
+
+		for(x::usize r = 0; r < count; r += 1){
+			auto dest = new_words.sub(r * new_stride, (r + 1) * new_stride);
+			x::mem_copy(dest.raw_data(), row(r).raw_data(), stride * sizeof(x::u64));
+		}
+
+		x::destroy(backing_allocator, words);
+		words  = new_words;
+		cap    = new_cap;
+		stride = new_stride;
+		return x::allocator::error::None;
+	}
+
+	// Change the number of rows and columns, new ones start out empty
+	x::allocator::error resize(x::usize n){
+		if(n > count){
+			auto err = reserve(n);
+			Or_Return(err);
+		}
+		else {
+			for(x::usize r = n; r < count; r += 1){
+				auto data = row(r);
+				x::mem_set(data.raw_data(), 0, data.size() * sizeof(x::u64));
+			}
+			for(x::usize r = 0; r < n; r += 1){
+				for(x::usize c = n; c < count; c += 1){
+					set(r, c, false);
+				}
+			}
+		}
+		count = n;
+		return x::allocator::error::None;
+	}
+
+	// Clear row and column `idx`
+	void clear_index(x::usize idx){
+		x::bounds_check(idx < count);
+
+		auto data = row(idx);
+		x::mem_set(data.raw_data(), 0, data.size() * sizeof(x::u64));
+
+		auto k = idx / word_bits;
+		auto mask = ~(x::u64(1) << (idx % word_bits));
+		for(x::usize r = 0; r < count; r += 1){
+			words[r * stride + k] &= mask;
+		}
+	}
+
+	// Drop every row and column whose keep flag is false. The remaining ones
+	// are renumbered in their original order.
+	x::allocator::error compact(x::view<bool> keep){
+		x::bounds_check(keep.size() == count);
+
+		auto [remap, err] = x::make_slice_checked<x::usize>(backing_allocator, count);
+		Or_Return(err);
+		Defer(x::destroy(backing_allocator, remap));
+
+		auto [scratch, scratch_err] = x::make_slice_checked<x::u64>(backing_allocator, stride);
+		Or_Return(scratch_err);
+		Defer(x::destroy(backing_allocator, scratch));
+
+		x::usize n = 0;
+		for(x::usize i = 0; i < count; i += 1){
+			if(keep[i]){
+				remap[i] = n;
+				n += 1;
+			}
+		}
+
+		// Row i only ever moves to a row <= i, so this can be done in place
+		for(x::usize i = 0; i < count; i += 1){
+			if(!keep[i]){ continue; }
+
+			x::mem_set(scratch.raw_data(), 0, stride * sizeof(x::u64));
+			for_each_in_row(i, [&](x::usize c){
+				if(keep[c]){
+					auto nc = remap[c];
+					scratch[nc / word_bits] |= x::u64(1) << (nc % word_bits);
+				}
+			});
+			x::mem_copy(row(remap[i]).raw_data(), scratch.raw_data(), stride * sizeof(x::u64));
+		}
+
+		for(x::usize r = n; r < count; r += 1){
+			auto data = row(r);
+			x::mem_set(data.raw_data(), 0, data.size() * sizeof(x::u64));
+		}
+
+		count = n;
+		return x::allocator::error::None;
+	}
+
+	// Same as compact(), but into out, which is replaced. The matrix itself
+	// is left as it is, so nothing changes when this fails.
+	x::allocator::error compact_into(bit_matrix& out, x::view<bool> keep) const {
+		x::bounds_check(keep.size() == count);
+
+		auto [remap, err] = x::make_slice_checked<x::usize>(backing_allocator, count);
+		Or_Return(err);
+		Defer(x::destroy(backing_allocator, remap));
+
+		x::usize n = 0;
+		for(x::usize i = 0; i < count; i += 1){
+			if(keep[i]){
+				remap[i] = n;
+				n += 1;
+			}
+		}
+
+		auto result = bit_matrix(backing_allocator);
+		err = result.resize(n);
+		Or_Return(err);
+
+		for(x::usize i = 0; i < count; i += 1){
+			if(!keep[i]){ continue; }
+			auto r = remap[i];
+			for_each_in_row(i, [&](x::usize c){
+				if(keep[c]){ result.set(r, remap[c], true); }
+			});
+		}
+
+		out = x::move(result);
+		return x::allocator::error::None;
+	}
+
+	bit_matrix(x::allocator al, x::usize n = 0)
+		: backing_allocator{al}
+	{
+		reserve(n);
+		count = n;
+	}
+
+	bit_matrix(bit_matrix const&) = delete;
+	void operator=(bit_matrix const&) = delete;
+
+	bit_matrix(bit_matrix&& m)
+		: backing_allocator{m.backing_allocator}
+	{
+		words  = x::exchange(m.words, x::slice<x::u64>{});
+		count  = x::exchange(m.count, 0);
+		cap    = x::exchange(m.cap, 0);
+		stride = x::exchange(m.stride, 0);
+	}
+
+	void operator=(bit_matrix&& m){
+		x::destroy(backing_allocator, words);
+		backing_allocator = m.backing_allocator;
+		words  = x::exchange(m.words, x::slice<x::u64>{});
+		count  = x::exchange(m.count, 0);
+		cap    = x::exchange(m.cap, 0);
+		stride = x::exchange(m.stride, 0);
+	}
+
+	~bit_matrix(){
+		x::destroy(backing_allocator, words);
+	}
+
+private:
+	x::allocator backing_allocator;
+	x::slice<x::u64> words;
+	x::usize count = 0;
+	x::usize cap = 0;
+	x::usize stride = 0;
+};
+
+#endif /* Include guard */
@@ -1,7 +1,7 @@
 #!/usr/bin/env sh
 
 cxx='g++ -std=c++20'
-cxxflags='-Wall -Wextra -O2 -static'
+cxxflags='-Wall -Wextra -O2 -static -pthread'
 
 Run(){ echo "$@"; $@; }
 
@@ -15,7 +15,7 @@
 // - Custom Allocator support without "polymorphic resource" madness
 // - Vector arithmetic built in
 // - Track calls with the `Caller_Location` macro
-// - dynamic_array, stack, queue, hash_map (TODO) that use the Allocator interface
+// - dynamic_array, stack, queue, hash_map that use the Allocator interface
 //   to get resources
 // - Memory Arena, convenience functions such as make() and make_slice()
 // - Slice-centric design to prevent bounds checking problems
@@ -122,6 +122,7 @@ using x::complex128;
 
 #include <source_location>
 #include <bit>
+#include <type_traits>
 // NOTE: Do **NOT** change the order of the ifdefs
 #if defined(__clang__)
 	#define COMPILER_VENDOR_CLANG 1
@@ -2267,6 +2268,16 @@ public:
 	string(string && s)
 		: data(x::move(s.data)) {}
 
+	constexpr
+	void operator=(string const& s){
+		data = s.data;
+	}
+
+	constexpr
+	void operator=(string&& s){
+		data = x::move(s.data);
+	}
+
 	constexpr
 	utf8_iterator begin() const {
 		return utf8_iterator(data);
@@ -2311,7 +2322,131 @@ char const* temp_cstring(string s, allocator temp_alloc){
 	return buf.raw_data();
 }
 
+// Growable byte buffer for putting text together piece by piece, so it can be
+// written out in one go instead of one small write per piece. Storage grows
+// geometrically and is kept across clear().
 struct string_builder {
+	constexpr
+	usize size() const {
+		return length;
+	}
+
+	constexpr
+	bool empty() const {
+		return length == 0;
+	}
+
+	// Contents so far, valid until the builder is modified
+	string build() const {
+		return string(view<byte>(data.raw_data(), length));
+	}
+
+	void clear(){
+		length = 0;
+	}
+
+	allocator::error push(byte b){
+		auto err = reserve(length + 1);
+		Or_Return(err);
+		data[length] = b;
+		length += 1;
+		return err;
+	}
+
+	allocator::error push(string s){
+		auto err = reserve(length + s.size());
+		Or_Return(err);
+		if(s.size() > 0){
+			mem_copy(data.raw_data() + length, s.raw_data(), s.size());
+		}
+		length += s.size();
+		return err;
+	}
+
+	allocator::error push(char const* cstr){
+		return push(string(cstr));
+	}
+
+	// Push c n times
+	allocator::error push_repeat(byte c, usize n){
+		auto err = reserve(length + n);
+		Or_Return(err);
+		if(n > 0){
+			mem_set(data.raw_data() + length, c, n);
+		}
+		length += n;
+		return err;
+	}
+
+	// Decimal representation of n
+	allocator::error push_integer(i64 n){
+		array<byte, 24> digits = {0};
+		usize count = 0;
+		u64 v = (n < 0) ? (~u64(n) + 1) : u64(n);
+		do {
+			digits[count] = byte('0' + (v % 10));
+			count += 1;
+			v /= 10;
+		} while(v > 0);
+
+		auto err = reserve(length + count + 1);
+		Or_Return(err);
+		if(n < 0){
+			data[length] = '-';
+			length += 1;
+		}
+		while(count > 0){
+			count -= 1;
+			data[length] = digits[count];
+			length += 1;
+		}
+		return err;
+	}
+
+	// Make room for n bytes in total
+	allocator::error reserve(usize n){
+		if(n <= data.size()){ return allocator::error::None; }
+
+		auto new_cap = max(n, data.size() * 2, usize(64));
+		auto [new_data, err] = make_slice_checked<byte>(backing_allocator, new_cap);
+		Or_Return(err);
+
+		if(length > 0){
+			mem_copy(new_data.raw_data(), data.raw_data(), length);
+		}
+		destroy(backing_allocator, data);
+		data = new_data;
+		return allocator::error::None;
+	}
+
+	string_builder(allocator al)
+		: backing_allocator{al} {}
+
+	string_builder(string_builder const&) = delete;
+	void operator=(string_builder const&) = delete;
+
+	string_builder(string_builder&& b)
+		: backing_allocator{b.backing_allocator}
+	{
+		data   = exchange(b.data, slice<byte>{});
+		length = exchange(b.length, 0);
+	}
+
+	void operator=(string_builder&& b){
+		destroy(backing_allocator, data);
+		backing_allocator = b.backing_allocator;
+		data   = exchange(b.data, slice<byte>{});
+		length = exchange(b.length, 0);
+	}
+
+	~string_builder(){
+		destroy(backing_allocator, data);
+	}
+
+private:
+	allocator backing_allocator;
+	slice<byte> data;
+	usize length = 0;
 };
 
 }
@@ -2644,20 +2779,51 @@ private:
 #define _queue_hpp_include_
 namespace x {
 
+// FIFO queue on a ring buffer. The capacity is always a power of two, so
+// wrapping around is a mask instead of a division, and grows by doubling.
 template<typename T>
 struct queue {
 	static constexpr usize default_initial_capacity = 16;
 
+	// Returns the new size, which stays the same if growing failed
 	constexpr
 	usize push(T const& val){
-		if((length + 1) >= items.size()){
-			bool ok = resize_capacity(max(length * 2, default_initial_capacity));
-			if(!ok){ return length; }
+		if(length == items.size()){
+			auto err = resize_capacity(max(length * 2, default_initial_capacity));
+			if(!error_ok(err)){ return length; }
 		}
 
-		usize idx = (first + length) % items.size();
-		items[idx] = val;
+		new (&items[slot(length)]) T(val);
 		length += 1;
+		return length;
+	}
+
+	constexpr
+	usize push(T&& val){
+		if(length == items.size()){
+			auto err = resize_capacity(max(length * 2, default_initial_capacity));
+			if(!error_ok(err)){ return length; }
+		}
+
+		new (&items[slot(length)]) T(x::move(val));
+		length += 1;
+		return length;
+	}
+
+	// Push every element of vals in order, either all of them or none if
+	// growing failed. Returns the new size.
+	constexpr
+	usize push_span(view<T> vals){
+		if((length + vals.size()) > items.size()){
+			auto err = resize_capacity(length + vals.size());
+			if(!error_ok(err)){ return length; }
+		}
+
+		for(usize i = 0; i < vals.size(); i += 1){
+			new (&items[slot(length + i)]) T(vals[i]);
+		}
+		length += vals.size();
+		return length;
 	}
 
 	constexpr
@@ -2672,16 +2838,42 @@ struct queue {
 		return items[first];
 	}
 
+	// Element idx positions away from the front
+	constexpr
+	T& operator[](usize idx){
+		bounds_check(idx < length);
+		return items[slot(idx)];
+	}
+
+	constexpr
+	T const& operator[](usize idx) const {
+		bounds_check(idx < length);
+		return items[slot(idx)];
+	}
+
 	constexpr
 	bool pop(){
 		bool ok = length > 0;
 		if(ok){
 			destruct(front());
-			first = (first + 1) % items.size();
+			first = slot(1);
+			length -= 1;
 		}
 		return ok;
 	}
 
+	// Move up to out.size() elements from the front into out, returns how
+	// many were moved.
+	constexpr
+	usize pop_span(slice<T> out){
+		auto n = min(out.size(), length);
+		for(usize i = 0; i < n; i += 1){
+			out[i] = x::move(front());
+			pop();
+		}
+		return n;
+	}
+
 	constexpr
 	bool empty() const {
 		return length == 0;
@@ -2693,17 +2885,81 @@ struct queue {
 	}
 
 	constexpr
-	void clear(){}
+	usize capacity() const {
+		return items.size();
+	}
+
+	// Remove every element, keeping the storage. O(1) for types without a
+	// destructor.
+	constexpr
+	void clear(){
+		if constexpr(!std::is_trivially_destructible_v<T>){
+			while(pop()){}
+		}
+		first  = 0;
+		length = 0;
+	}
+
+	// Grow the storage to hold at least new_cap elements, rounded up to a
+	// power of two. Elements are moved so the front is at the start again.
+	allocator::error resize_capacity(usize new_cap){
+		debug_assert(new_cap >= length, "Queue does not support down-sizing");
+		new_cap = std::bit_ceil(max(new_cap, usize(1)));
+		if(new_cap <= items.size()){ return allocator::error::None; }
+
+		auto [new_items, err] = make_slice_raw<T>(backing_allocator, new_cap);
+		Or_Return(err);
+
+		for(usize i = 0; i < length; i += 1){
+			auto& val = items[slot(i)];
+			new (&new_items[i]) T(x::move(val));
+			destruct(val);
+		}
+
+		backing_allocator.free(items.raw_data());
+		items = new_items;
+		first = 0;
+		return allocator::error::None;
+	}
 
 	queue(allocator al, usize initial_cap = default_initial_capacity)
-		: backing_allocator{al}, first{0}, length{0}, items{} {}
+		: first{0}, length{0}, items{}, backing_allocator{al}
+	{
+		resize_capacity(initial_cap);
+	}
+
+	queue(queue const&) = delete;
+	void operator=(queue const&) = delete;
+
+	queue(queue&& q)
+		: backing_allocator{q.backing_allocator}
+	{
+		first  = x::exchange(q.first, 0);
+		length = x::exchange(q.length, 0);
+		items  = x::exchange(q.items, slice<T>{});
+	}
 
-	bool resize_capacity(usize new_cap){
-		unimplemented();
-		debug_assert(new_cap > items.size(), "Queue does not support down-sizing");
+	void operator=(queue&& q){
+		clear();
+		backing_allocator.free(items.raw_data());
+		backing_allocator = q.backing_allocator;
+		first  = x::exchange(q.first, 0);
+		length = x::exchange(q.length, 0);
+		items  = x::exchange(q.items, slice<T>{});
+	}
+
+	~queue(){
+		clear();
+		backing_allocator.free(items.raw_data());
+		items = slice<T>{};
 	}
 
 private:
+	constexpr
+	usize slot(usize idx) const {
+		return (first + idx) & (items.size() - 1);
+	}
+
 	usize first;
 	usize length;
 	slice<T> items;
@@ -2713,6 +2969,226 @@ private:
 static_assert(queue<int>::default_initial_capacity > 1);
 }
 
+#endif /* Include guard */
+// Hash Map ////////////////////////////////////////////////////////////////////
+#ifndef _hash_map_hpp_include_
+#define _hash_map_hpp_include_
+namespace x {
+// Integer mixing function (splitmix64 finalizer)
+constexpr
+u64 hash(u64 v){
+	v ^= v >> 30;
+	v *= 0xbf58476d1ce4e5b9ull;
+	v ^= v >> 27;
+	v *= 0x94d049bb133111ebull;
+	v ^= v >> 31;
+	return v;
+}
+
+// FNV-1a over a sequence of bytes
+constexpr
+u64 hash_bytes(byte const* data, usize n){
+	u64 h = 0xcbf29ce484222325ull;
+	for(usize i = 0; i < n; i += 1){
+		h ^= u64(data[i]);
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+constexpr
+u64 hash(string const& s){
+	return hash_bytes(s.raw_data(), s.size());
+}
+
+// Open addressing hash map with linear probing. Keys are hashed by calling
+// hash(key) unqualified, so user types can provide an overload in their own
+// namespace. Keys and values must be default constructible.
+template<typename K, typename V>
+struct hash_map {
+	static constexpr usize default_initial_capacity = 16;
+
+	enum struct slot_state : u8 {
+		Empty = 0,
+		Used,
+		Deleted,
+	};
+
+	struct slot {
+		K key;
+		V value;
+		slot_state state;
+	};
+
+	constexpr
+	usize size() const {
+		return length;
+	}
+
+	constexpr
+	usize capacity() const {
+		return slots.size();
+	}
+
+	constexpr
+	bool empty() const {
+		return length == 0;
+	}
+
+	// Get value associated with key
+	pair<V, bool> get(K const& key) const {
+		auto idx = find(key);
+		if(idx < 0){ return {V{}, false}; }
+		return {slots[idx].value, true};
+	}
+
+	bool has(K const& key) const {
+		return find(key) >= 0;
+	}
+
+	// Insert or update key, returns false if the map could not grow
+	bool set(K const& key, V const& value){
+		if(((length + tombstones + 1) * 4) > (slots.size() * 3)){
+			// Rehashing at the same size is enough to drop tombstones
+			auto new_cap = ((length + 1) * 2 > slots.size()) ? slots.size() * 2 : slots.size();
+			auto err = resize_capacity(max(new_cap, default_initial_capacity));
+			if(!error_ok(err)){ return false; }
+		}
+
+		auto mask = slots.size() - 1;
+		auto i = usize(hash(key)) & mask;
+		isize reuse = -1;
+
+		while(1){
+			auto& s = slots[i];
+			if(s.state == slot_state::Empty){ break; }
+			if(s.state == slot_state::Deleted){
+				if(reuse < 0){ reuse = i; }
+			}
+			else if(s.key == key){
+				s.value = value;
+				return true;
+			}
+			i = (i + 1) & mask;
+		}
+
+		if(reuse >= 0){
+			i = reuse;
+			tombstones -= 1;
+		}
+		slots[i] = slot{key, value, slot_state::Used};
+		length += 1;
+		return true;
+	}
+
+	// Remove key, returns false if it was not present
+	bool del(K const& key){
+		auto idx = find(key);
+		if(idx < 0){ return false; }
+
+		slots[idx] = slot{K{}, V{}, slot_state::Deleted};
+		length -= 1;
+		tombstones += 1;
+		return true;
+	}
+
+	// Remove all entries, retains capacity
+	void clear(){
+		for(auto& s : slots){
+			s = slot{K{}, V{}, slot_state::Empty};
+		}
+		length = 0;
+		tombstones = 0;
+	}
+
+	// Rehash into new_cap slots, new_cap is rounded up to a power of 2
+	allocator::error resize_capacity(usize new_cap){
+		new_cap = std::bit_ceil(max(new_cap, usize(1)));
+		if(((length + 1) * 4) > (new_cap * 3)){
+			return allocator::error::CannotResize;
+		}
+
+		auto [new_slots, err] = make_slice_checked<slot>(backing_allocator, new_cap);
+		Or_Return(err);
+
+		auto old_slots = x::exchange(slots, new_slots);
+		length = 0;
+		tombstones = 0;
+
+		for(auto const& s : old_slots){
+			if(s.state == slot_state::Used){
+				set(s.key, s.value);
+			}
+		}
+
+		destroy(backing_allocator, old_slots);
+		return allocator::error::None;
+	}
+
+	template<typename Func>
+	void for_each(Func&& fn) const {
+		for(auto const& s : slots){
+			if(s.state == slot_state::Used){
+				fn(s.key, s.value);
+			}
+		}
+	}
+
+	hash_map(allocator al, usize cap = default_initial_capacity)
+		: backing_allocator{al}, slots{}, length{0}, tombstones{0}
+	{
+		resize_capacity(cap);
+	}
+
+	hash_map(hash_map const&) = delete;
+	void operator=(hash_map const&) = delete;
+
+	hash_map(hash_map&& m)
+		: backing_allocator{m.backing_allocator}
+	{
+		slots      = x::exchange(m.slots, slice<slot>{});
+		length     = x::exchange(m.length, 0);
+		tombstones = x::exchange(m.tombstones, 0);
+	}
+
+	void operator=(hash_map&& m){
+		destroy(backing_allocator, slots);
+		backing_allocator = m.backing_allocator;
+		slots      = x::exchange(m.slots, slice<slot>{});
+		length     = x::exchange(m.length, 0);
+		tombstones = x::exchange(m.tombstones, 0);
+	}
+
+	~hash_map(){
+		destroy(backing_allocator, slots);
+	}
+
+private:
+	isize find(K const& key) const {
+		if(length == 0){ return -1; }
+
+		auto mask = slots.size() - 1;
+		auto i = usize(hash(key)) & mask;
+
+		while(1){
+			auto const& s = slots[i];
+			if(s.state == slot_state::Empty){ return -1; }
+			if((s.state == slot_state::Used) && (s.key == key)){
+				return isize(i);
+			}
+			i = (i + 1) & mask;
+		}
+	}
+
+	x::allocator backing_allocator;
+	slice<slot> slots;
+	usize length;
+	usize tombstones;
+};
+
+static_assert(hash_map<int, int>::default_initial_capacity > 1);
+}
+
 #endif /* Include guard */
 // Bump Allocator //////////////////////////////////////////////////////////////
 #ifndef _bump_allocator_hpp_include_
@@ -2759,7 +3235,7 @@ struct bump_allocator {
 		uintptr pad = align_forward(start, align) - start;
 		uintptr required = offset_ + pad + size;
 
-		if(required > available_space()){
+		if(required > data_.size()){
 			err = error::OutOfMemory;
 			return {nullptr, err};
 		}
@@ -2795,8 +3271,7 @@ struct bump_allocator {
 		auto last     = uintptr(last_allocation_);
 		auto required = (last - base) + new_size;
 
-		auto last_offset = base - last;
-		if(required > (data_.size() - last_offset)){
+		if(required > data_.size()){
 			return {nullptr, error::OutOfMemory};
 		}
 
@@ -2993,16 +3468,21 @@ struct arena_allocator {
 
 	allocator backing_alloc = {};
 	dynamic_array<bump_allocator> mem_pools;
+	// Pool allocations are taken from, the ones before it are full and the
+	// ones after it were kept by a reset
+	usize current_pool = 0;
 
 	pair<void*, error> alloc(usize size, usize align, Caller_Location){
 		panic_assert(valid_alignment(align), "Bad alignment", caller_location);
 		if(size == 0){ return {0, error::None }; }
 
-		for(auto& pool : mem_pools){
-			auto [ptr, err] = pool.alloc(size, align);
+		while(current_pool < mem_pools.size()){
+			auto [ptr, err] = mem_pools[current_pool].alloc(size, align);
 			if(error_ok(err)){
 				return {ptr, error::None};
 			}
+			if(current_pool + 1 == mem_pools.size()){ break; }
+			current_pool += 1;
 		}
 
 		// No pool available, create new one
@@ -3011,7 +3491,8 @@ struct arena_allocator {
 			return {nullptr, err};
 		}
 
-		return mem_pools[mem_pools.size() - 1].alloc(size, align);
+		current_pool = mem_pools.size() - 1;
+		return mem_pools[current_pool].alloc(size, align);
 	}
 
 	pair<void*, error> resize(void* ptr, usize new_size, Caller_Location){
@@ -3034,6 +3515,7 @@ struct arena_allocator {
 	}
 
 	void reset(reset_mode policy = reset_mode::RetainCapacity){
+		current_pool = 0;
 		switch (policy) {
 			case reset_mode::RetainCapacity: {
 				for(auto& pool : mem_pools){
@@ -3052,11 +3534,13 @@ struct arena_allocator {
 
 	}
 
+	// Pools double in size, so there are only O(log n) of them for n bytes
 	error create_new_pool(usize size, usize align, Caller_Location) {
-		// Make damn sure there's enough size.
-		auto size_aligned      = align_forward(size, align);
+		// Make damn sure there's enough size, padding included.
+		auto size_aligned      = align_forward(size, align) + align;
 		auto min_pool_aligned  = align_forward(default_min_pool_size, align);
-		auto real_size         = max(size_aligned, min_pool_aligned);
+		auto last_pool_size    = mem_pools.empty() ? 0 : mem_pools[mem_pools.size() - 1].size();
+		auto real_size         = max(size_aligned, min_pool_aligned, last_pool_size * 2);
 
 		auto [data, err] = make_slice_checked<u8>(backing_alloc, real_size);
 
@@ -3127,6 +3611,245 @@ x::allocator arena_allocator::as_allocator() & {
 	return x::allocator(this, _arena_allocator_proc);
 }
 
+}
+#endif /* Include guard */
+// Thread Arena Allocator //////////////////////////////////////////////////////
+#ifndef _thread_arena_allocator_hpp_include_
+#define _thread_arena_allocator_hpp_include_
+
+#include <atomic>
+
+namespace x {
+// An arena that any number of threads can allocate from at once. Every thread
+// bumps through a chunk of its own, so allocating takes no lock and touches no
+// shared memory. A thread that runs out takes a new chunk from a shared lock
+// free list, and the list is refilled from the backing allocator, which has to
+// be thread safe (like the heap). Allocations larger than a quarter of a chunk
+// get a chunk of their own.
+//
+// Like arena_allocator, memory is only released all at once by reset(), which
+// must not run concurrently with any allocation.
+struct thread_arena_allocator {
+	using error = allocator::error;
+	using reset_mode = arena_allocator::reset_mode;
+	static constexpr usize default_chunk_size = 256 * 1024;
+	// Arenas a thread can allocate from before it starts dropping the chunk
+	// of the least recently added one
+	static constexpr usize max_thread_caches = 8;
+
+	pair<void*, error> alloc(usize size, usize align, Caller_Location){
+		panic_assert(valid_alignment(align), "Bad alignment", caller_location);
+		if(size == 0){ return {0, error::None }; }
+
+		auto& pool = local_pool();
+		auto [ptr, err] = pool.alloc(size, align);
+		if(error_ok(err)){
+			return {ptr, error::None};
+		}
+
+		if(size + align > chunk_size / 4){
+			auto [c, chunk_err] = new_chunk(size + align);
+			if(!error_ok(chunk_err)){
+				return {nullptr, chunk_err};
+			}
+			push_used(c);
+			auto single = bump_allocator(chunk_data(c));
+			return single.alloc(size, align);
+		}
+
+		auto [c, chunk_err] = take_chunk();
+		if(!error_ok(chunk_err)){
+			return {nullptr, chunk_err};
+		}
+		pool = bump_allocator(chunk_data(c));
+		return pool.alloc(size, align);
+	}
+
+	// Only the last allocation of the calling thread can be resized
+	pair<void*, error> resize(void* ptr, usize new_size, Caller_Location){
+		auto& pool = local_pool();
+		if(!pool.owns_ptr(ptr)){
+			return {nullptr, error::NotOwnedPointer};
+		}
+		return pool.resize(ptr, new_size);
+	}
+
+	void reset(reset_mode policy = reset_mode::RetainCapacity){
+		// Pools of every thread refer to the old generation and are dropped
+		// on their next allocation
+		generation.store(next_generation());
+
+		auto c = used_chunks.exchange(nullptr);
+		auto free_list = free_chunks.load();
+		while(c != nullptr){
+			auto next = c->next_used;
+			if((policy == reset_mode::RetainCapacity) && (c->size == chunk_size)){
+				c->next_free = free_list;
+				free_list = c;
+			}
+			else {
+				backing_alloc.free(c);
+			}
+			c = next;
+		}
+
+		if(policy == reset_mode::DeallocAll){
+			while(free_list != nullptr){
+				auto next = free_list->next_free;
+				backing_alloc.free(free_list);
+				free_list = next;
+			}
+		}
+		free_chunks.store(free_list);
+	}
+
+	constexpr
+	x::allocator as_allocator() &;
+
+	thread_arena_allocator(x::allocator backing, usize chunk_bytes = default_chunk_size)
+		: backing_alloc{backing},
+		chunk_size{max(chunk_bytes, arena_allocator::default_min_pool_size)},
+		generation{next_generation()} {}
+
+	thread_arena_allocator(thread_arena_allocator const&) = delete;
+	void operator=(thread_arena_allocator const&) = delete;
+
+	~thread_arena_allocator(){
+		reset(reset_mode::DeallocAll);
+	}
+
+private:
+	// Header of a block from the backing allocator, its usable memory
+	// follows it
+	struct chunk {
+		chunk* next_free;
+		chunk* next_used;
+		usize size;
+	};
+
+	struct thread_pool {
+		u64 generation = 0;
+		bump_allocator pool;
+	};
+
+	// Generations come from one counter shared by all arenas, so a pool
+	// left by an arena that was destroyed can never be taken for the pool
+	// of a new one.
+	static u64 next_generation(){
+		static std::atomic<u64> counter{0};
+		return counter.fetch_add(1) + 1;
+	}
+
+	bump_allocator& local_pool(){
+		thread_local thread_pool pools[max_thread_caches];
+		thread_local usize next_slot = 0;
+
+		auto gen = generation.load();
+		for(auto& p : pools){
+			if(p.generation == gen){ return p.pool; }
+		}
+
+		// What was left of the chunk in the slot stays on the used list of
+		// its arena and is released with it
+		auto& p = pools[next_slot % max_thread_caches];
+		next_slot += 1;
+		p.generation = gen;
+		p.pool = bump_allocator();
+		return p.pool;
+	}
+
+	static slice<u8> chunk_data(chunk* c){
+		return slice<u8>((u8*)(c + 1), c->size);
+	}
+
+	pair<chunk*, error> new_chunk(usize size){
+		auto [raw, err] = backing_alloc.alloc(sizeof(chunk) + size, alignof(chunk));
+		if(!error_ok(err)){
+			return {nullptr, err};
+		}
+		auto c = static_cast<chunk*>(raw);
+		c->size = size;
+		return {c, error::None};
+	}
+
+	// Chunks are only pushed on the free list by reset(), so popping
+	// concurrently cannot run into the ABA problem
+	pair<chunk*, error> take_chunk(){
+		auto c = free_chunks.load();
+		while((c != nullptr) && !free_chunks.compare_exchange_weak(c, c->next_free)){}
+
+		if(c == nullptr){
+			auto [fresh, err] = new_chunk(chunk_size);
+			if(!error_ok(err)){
+				return {nullptr, err};
+			}
+			c = fresh;
+		}
+		push_used(c);
+		return {c, error::None};
+	}
+
+	void push_used(chunk* c){
+		auto head = used_chunks.load();
+		do {
+			c->next_used = head;
+		} while(!used_chunks.compare_exchange_weak(head, c));
+	}
+
+	allocator backing_alloc = {};
+	usize chunk_size;
+	std::atomic<u64> generation;
+	// Chunks kept by a reset, ready to be handed out
+	std::atomic<chunk*> free_chunks{nullptr};
+	// Chunks handed out since the last reset
+	std::atomic<chunk*> used_chunks{nullptr};
+};
+
+[[maybe_unused]] static
+pair<void*, allocator::error> _thread_arena_allocator_proc (
+	void* impl,
+	allocator::operation operation,
+	usize new_size,
+	usize align,
+	void* old_ptr,
+	usize,
+	Caller_Location
+){
+	using Op = allocator::operation;
+	auto arena = static_cast<thread_arena_allocator*>(impl);
+	auto err = thread_arena_allocator::error::None;
+
+	switch (operation) {
+		case Op::Alloc: {
+			return arena->alloc(new_size, align, caller_location);
+		} break;
+
+		case Op::Resize: {
+			return arena->resize(old_ptr, new_size, caller_location);
+		} break;
+
+		case Op::Free: {
+			err = thread_arena_allocator::error::UnsupportedOperation;
+		} break;
+
+		case Op::FreeAll: {
+			arena->reset();
+		} break;
+
+		default:{
+			err = thread_arena_allocator::error::UnsupportedOperation;
+			unreachable();
+		} break;
+	}
+
+	return {nullptr, err};
+}
+
+inline constexpr
+x::allocator thread_arena_allocator::as_allocator() & {
+	return x::allocator(this, _thread_arena_allocator_proc);
+}
+
 }
 #endif /* Include guard */
 // Tracking Allocator //////////////////////////////////////////////////////////
@@ -0,0 +1,163 @@
+#ifndef _csr_hpp_include_
+#define _csr_hpp_include_
+
+#include "core.hpp"
+
+// Compressed sparse row adjacency over the nodes 0..size()-1. The neighbours of
+// node i are stored in neighbors[offsets[i]..offsets[i+1]] in ascending order,
+// so traversals run in O(V+E) instead of scanning a full matrix row for every
+// visited node. The transposed graph is kept the same way in
+// in_offsets/in_neighbors.
+struct csr_adjacency {
+	x::slice<x::usize> offsets;
+	x::slice<x::u32> neighbors;
+	x::slice<x::usize> in_offsets;
+	x::slice<x::u32> in_neighbors;
+	// Optional, weight of the edge at the same position of neighbors. Every
+	// edge weighs 1 when empty. Owned like the lists.
+	x::slice<x::u32> weights;
+
+	x::usize size() const {
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+
+	x::usize edge_count() const {
+		return neighbors.size();
+	}
+
+	x::usize degree(x::usize node) const {
+		return offsets[node + 1] - offsets[node];
+	}
+
+	x::view<x::u32> neighbors_of(x::usize node) const {
+		return x::view(neighbors).sub(offsets[node], offsets[node + 1]);
+	}
+
+	template<typename Func>
+	void for_each_neighbor(x::usize node, Func&& fn) const {
+		auto end = offsets[node + 1];
+		for(x::usize i = offsets[node]; i < end; i += 1){
+			fn(x::usize(neighbors[i]));
+		}
+	}
+
+	// Call fn(neighbor, weight) for every out edge
+	template<typename Func>
+	void for_each_weighted_neighbor(x::usize node, Func&& fn) const {
+		auto end = offsets[node + 1];
+		for(x::usize i = offsets[node]; i < end; i += 1){
+			fn(x::usize(neighbors[i]), weights.empty() ? x::u32(1) : weights[i]);
+		}
+	}
+
+	x::isize next_neighbor(x::usize node, x::usize& cursor) const {
+		auto pos = offsets[node] + cursor;
+		if(pos >= offsets[node + 1]){ return -1; }
+		cursor += 1;
+		return x::isize(neighbors[pos]);
+	}
+
+	x::isize next_in_neighbor(x::usize node, x::usize& cursor) const {
+		auto pos = in_offsets[node] + cursor;
+		if(pos >= in_offsets[node + 1]){ return -1; }
+		cursor += 1;
+		return x::isize(in_neighbors[pos]);
+	}
+
+	// Binary search, neighbour lists are sorted
+	bool has_edge(x::usize from, x::usize to) const {
+		auto adj = neighbors_of(from);
+		x::usize lo = 0, hi = adj.size();
+		while(lo < hi){
+			auto mid = lo + (hi - lo) / 2;
+			if(adj[mid] < x::u32(to)){ lo = mid + 1; }
+			else { hi = mid; }
+		}
+		return (lo < adj.size()) && (adj[lo] == x::u32(to));
+	}
+
+	// Take ownership of forward lists, which must be sorted and free of
+	// duplicates, and derive the reverse ones from them.
+	csr_adjacency(x::allocator al, x::slice<x::usize> offsets, x::slice<x::u32> neighbors)
+		: offsets{offsets}, neighbors{neighbors}, backing_allocator{al}
+	{
+		build_reverse();
+	}
+
+	// Take ownership of all four lists as they are, nothing is rebuilt
+	csr_adjacency(x::allocator al, x::slice<x::usize> offsets, x::slice<x::u32> neighbors,
+		x::slice<x::usize> in_offsets, x::slice<x::u32> in_neighbors)
+		: offsets{offsets}, neighbors{neighbors}, in_offsets{in_offsets},
+		in_neighbors{in_neighbors}, backing_allocator{al} {}
+
+	explicit
+	csr_adjacency(x::allocator al)
+		: backing_allocator{al} {}
+
+	csr_adjacency(csr_adjacency const&) = delete;
+	void operator=(csr_adjacency const&) = delete;
+
+	csr_adjacency(csr_adjacency&& g)
+		: backing_allocator{g.backing_allocator}
+	{
+		offsets      = x::exchange(g.offsets, x::slice<x::usize>{});
+		neighbors    = x::exchange(g.neighbors, x::slice<x::u32>{});
+		in_offsets   = x::exchange(g.in_offsets, x::slice<x::usize>{});
+		in_neighbors = x::exchange(g.in_neighbors, x::slice<x::u32>{});
+		weights      = x::exchange(g.weights, x::slice<x::u32>{});
+	}
+
+	void operator=(csr_adjacency&& g){
+		release();
+		backing_allocator = g.backing_allocator;
+		offsets      = x::exchange(g.offsets, x::slice<x::usize>{});
+		neighbors    = x::exchange(g.neighbors, x::slice<x::u32>{});
+		in_offsets   = x::exchange(g.in_offsets, x::slice<x::usize>{});
+		in_neighbors = x::exchange(g.in_neighbors, x::slice<x::u32>{});
+		weights      = x::exchange(g.weights, x::slice<x::u32>{});
+	}
+
+	~csr_adjacency(){
+		release();
+	}
+
+private:
+	// Sources are visited in ascending order, so every in-list comes out
+	// sorted.
+	void build_reverse(){
+		auto n = size();
+		in_offsets = x::make_slice<x::usize>(backing_allocator, n + 1);
+		in_neighbors = x::make_slice<x::u32>(backing_allocator, neighbors.size());
+
+		for(auto v : neighbors){
+			in_offsets[v + 1] += 1;
+		}
+		for(x::usize i = 1; i < in_offsets.size(); i += 1){
+			in_offsets[i] += in_offsets[i - 1];
+		}
+
+		auto fill = x::make_slice<x::usize>(backing_allocator, n);
+		Defer(x::destroy(backing_allocator, fill));
+		for(x::usize i = 0; i < n; i += 1){
+			fill[i] = in_offsets[i];
+		}
+		for(x::usize u = 0; u < n; u += 1){
+			for_each_neighbor(u, [&](x::usize v){
+				in_neighbors[fill[v]] = x::u32(u);
+				fill[v] += 1;
+			});
+		}
+	}
+
+	void release(){
+		x::destroy(backing_allocator, offsets);
+		x::destroy(backing_allocator, neighbors);
+		x::destroy(backing_allocator, in_offsets);
+		x::destroy(backing_allocator, in_neighbors);
+		x::destroy(backing_allocator, weights);
+	}
+
+	x::allocator backing_allocator;
+};
+
+#endif /* Include guard */
@@ -0,0 +1,259 @@
+#ifndef _dynamic_closure_hpp_include_
+#define _dynamic_closure_hpp_include_
+
+#include "core.hpp"
+#include "bit_matrix.hpp"
+
+// Transitive closure that is kept up to date while edges and nodes come and
+// go, so a reachability query is a single bit test. Row i holds every node
+// that can be reached from i, i itself included. The graph has to provide
+// for_each_neighbor() and next_in_neighbor(), and must already reflect an
+// update when it is passed to the closure.
+//
+// Inserting u -> v ORs the row of v into every row that has u (Italiano's
+// update, on bitsets), which costs nothing when v could already be reached
+// from u. Deletions can only shrink the rows that reach u: those are marked
+// stale and rebuilt by a search that stops at every node whose row is still
+// valid and ORs that row in instead, once per strongly connected component,
+// so the work stays within the part of the graph that could have changed.
+struct dynamic_closure {
+	bool enabled() const {
+		return active;
+	}
+
+	x::usize size() const {
+		return reach.size();
+	}
+
+	bool reachable(x::usize from, x::usize to) const {
+		return reach.get(from, to);
+	}
+
+	x::view<x::u64> row(x::usize node) const {
+		return reach.row(node);
+	}
+
+	// Start from a full closure, as given by reachability_bits(). Bits on the
+	// diagonal are set whatever their value.
+	void assign(bit_matrix&& closure){
+		reach = x::move(closure);
+		states.clear();
+		for(x::usize i = 0; i < reach.size(); i += 1){
+			reach.set(i, i, true);
+			states.append(row_state::Valid);
+		}
+		active = true;
+	}
+
+	// Stop tracking and release the closure
+	void reset(){
+		reach = bit_matrix(backing_allocator);
+		states.clear();
+		active = false;
+	}
+
+	// New slots start out reaching only themselves
+	x::allocator::error resize(x::usize n){
+		auto old = reach.size();
+		auto err = reach.resize(n);
+		Or_Return(err);
+		while(states.size() > n){ states.pop(); }
+		for(x::usize i = old; i < n; i += 1){
+			reach.set(i, i, true);
+			states.append(row_state::Valid);
+		}
+		return x::allocator::error::None;
+	}
+
+	// A slot was reused for a new node, its row and column are empty
+	void add_node(x::usize node){
+		reach.set(node, node, true);
+	}
+
+	x::allocator::error compact(x::view<bool> keep){
+		auto err = reach.compact(keep);
+		Or_Return(err);
+		while(states.size() > reach.size()){ states.pop(); }
+		return x::allocator::error::None;
+	}
+
+	void insert_edge(x::usize from, x::usize to){
+		if(reach.get(from, to)){ return; }
+
+		// When to reaches from its row already holds every row it gets ORed
+		// into, including its own, so updating it in place is harmless.
+		for(x::usize r = 0; r < reach.size(); r += 1){
+			if(reach.get(r, from)){
+				bit_or(reach.row(r), reach.row(to));
+			}
+		}
+	}
+
+	template<typename Graph>
+	void remove_edge(Graph const& g, x::usize from, x::usize to){
+		if(from == to){ return; }
+		mark_stale(from);
+
+		// If to can still be reached from `from`, every path through the
+		// edge has a detour and no row changes.
+		auto detour = still_reaches(g, from, to);
+		for(auto r : pending){
+			states[r] = detour ? row_state::Valid : row_state::Stale;
+		}
+		if(detour){
+			pending.clear();
+			return;
+		}
+		rebuild_stale(g);
+	}
+
+	// Call after the edges of node were cleared from g
+	template<typename Graph>
+	void remove_node(Graph const& g, x::usize node){
+		mark_stale(node);
+		states[node] = row_state::Valid;
+		reach.clear_index(node);
+		rebuild_stale(g);
+	}
+
+	explicit
+	dynamic_closure(x::allocator al)
+		: backing_allocator{al}, reach(al), states(al), pending(al), stack(al) {}
+
+	dynamic_closure(dynamic_closure const&) = delete;
+	void operator=(dynamic_closure const&) = delete;
+
+	dynamic_closure(dynamic_closure&& c)
+		: backing_allocator{c.backing_allocator},
+		reach{x::move(c.reach)},
+		states{x::move(c.states)},
+		pending{x::move(c.pending)},
+		stack{x::move(c.stack)},
+		active{x::exchange(c.active, false)} {}
+
+	void operator=(dynamic_closure&& c){
+		backing_allocator = c.backing_allocator;
+		reach   = x::move(c.reach);
+		states  = x::move(c.states);
+		pending = x::move(c.pending);
+		stack   = x::move(c.stack);
+		active  = x::exchange(c.active, false);
+	}
+
+private:
+	enum struct row_state : x::u8 {
+		Valid = 0,
+		// Reaches the source of a deletion, may hold too many bits
+		Stale,
+		// Stale, and already visited by still_reaches()
+		Visited,
+	};
+
+	// Every row that reaches node may lose bits
+	void mark_stale(x::usize node){
+		pending.clear();
+		for(x::usize r = 0; r < reach.size(); r += 1){
+			if(reach.get(r, node)){
+				states[r] = row_state::Stale;
+				pending.append(r);
+			}
+		}
+	}
+
+	// Search for to through stale rows, stopping at the first valid row
+	// that has it. Leaves the rows it went through marked as visited.
+	template<typename Graph>
+	bool still_reaches(Graph const& g, x::usize from, x::usize to){
+		stack.clear();
+		stack.append(from);
+		states[from] = row_state::Visited;
+		while(!stack.empty()){
+			auto v = stack[stack.size() - 1];
+			stack.pop();
+
+			bool found = false;
+			g.for_each_neighbor(v, [&](x::usize w){
+				if(found){ return; }
+				if(w == to){ found = true; }
+				else if(states[w] == row_state::Stale){
+					states[w] = row_state::Visited;
+					stack.append(w);
+				}
+				else if((states[w] == row_state::Valid) && reach.get(w, to)){
+					found = true;
+				}
+			});
+			if(found){ return true; }
+		}
+		return false;
+	}
+
+	template<typename Graph>
+	void rebuild_stale(Graph const& g){
+		for(auto r : pending){
+			if(states[r] != row_state::Stale){ continue; }
+			rebuild_row(g, r);
+			share_row(g, r);
+		}
+		pending.clear();
+	}
+
+	// Stale rows that reach node and can be reached from it are in its
+	// component and get the same row. A component that reaches the source
+	// of a deletion is entirely stale, so the search stays on stale rows.
+	template<typename Graph>
+	void share_row(Graph const& g, x::usize node){
+		auto src = reach.row(node);
+		stack.clear();
+		stack.append(node);
+		while(!stack.empty()){
+			auto v = stack[stack.size() - 1];
+			stack.pop();
+
+			x::usize cursor = 0;
+			for(auto w = g.next_in_neighbor(v, cursor); w >= 0; w = g.next_in_neighbor(v, cursor)){
+				if((states[w] != row_state::Stale) || !reach.get(node, w)){ continue; }
+				auto dest = reach.row(w);
+				x::mem_copy(dest.raw_data(), src.raw_data(), dest.size() * sizeof(x::u64));
+				states[w] = row_state::Valid;
+				stack.append(w);
+			}
+		}
+	}
+
+	// Search from node through stale rows, a valid row is complete and gets
+	// ORed in as a whole instead of being searched.
+	template<typename Graph>
+	void rebuild_row(Graph const& g, x::usize node){
+		auto dest = reach.row(node);
+		x::mem_set(dest.raw_data(), 0, dest.size() * sizeof(x::u64));
+		reach.set(node, node, true);
+
+		stack.clear();
+		stack.append(node);
+		while(!stack.empty()){
+			auto v = stack[stack.size() - 1];
+			stack.pop();
+			g.for_each_neighbor(v, [&](x::usize w){
+				if(reach.get(node, w)){ return; }
+				if(states[w] == row_state::Stale){
+					reach.set(node, w, true);
+					stack.append(w);
+				}
+				else {
+					bit_or(dest, reach.row(w));
+				}
+			});
+		}
+		states[node] = row_state::Valid;
+	}
+
+	x::allocator backing_allocator;
+	bit_matrix reach;
+	x::dynamic_array<row_state> states;
+	x::dynamic_array<x::usize> pending;
+	x::dynamic_array<x::usize> stack;
+	bool active = false;
+};
+
+#endif /* Include guard */
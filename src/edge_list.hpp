@@ -0,0 +1,279 @@
+#ifndef _edge_list_hpp_include_
+#define _edge_list_hpp_include_
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "mapped_file.hpp"
+
+#include <thread>
+#include <algorithm>
+
+// Plain text edge lists, one "src dst" pair of node ids per line separated by
+// spaces or tabs. Anything after the second id is ignored, so are blank lines
+// and lines starting with '#' or '%'. Ids are dense unsigned integers, the
+// graph gets one node more than the highest id.
+enum struct edge_list_error : x::i32 {
+	None = 0,
+	OpenFailed,
+	BadFormat,
+	TooManyNodes,
+};
+
+// Most nodes an edge list can have, ids are stored as u32 and ~u32(0) is
+// reserved
+constexpr x::usize edge_list_max_nodes = x::usize(~x::u32(0));
+
+namespace edge_list_impl {
+using x::usize, x::u32, x::u64, x::error_ok;
+
+// Below this many bytes per thread splitting the file is not worth it
+constexpr usize min_chunk_size = usize(1) << 20;
+
+struct chunk {
+	usize begin;
+	usize end;
+};
+
+inline bool blank(char c){
+	return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+inline bool digit(char c){
+	return (c >= '0') && (c <= '9');
+}
+
+// Call fn(src, dst) for every edge in text[begin, end). The range must start
+// at the beginning of a line. Ids of max_nodes or more are refused as soon as
+// they are read, so nothing is ever sized after them.
+template<typename Func>
+edge_list_error parse_lines(char const* text, usize begin, usize end, usize max_nodes, Func&& fn){
+	auto max_id = u64(max_nodes) - 1;
+	auto p = text + begin;
+	auto stop = text + end;
+
+	// The last line may have no line break, p must not go past stop
+	auto skip_line = [&](){
+		while((p < stop) && (*p != '\n')){ p += 1; }
+		if(p < stop){ p += 1; }
+	};
+
+	auto read_id = [&](u64& id) -> edge_list_error {
+		if((p >= stop) || !digit(*p)){ return edge_list_error::BadFormat; }
+		id = 0;
+		while((p < stop) && digit(*p)){
+			id = id * 10 + u64(*p - '0');
+			if((max_nodes == 0) || (id > max_id)){ return edge_list_error::TooManyNodes; }
+			p += 1;
+		}
+		return edge_list_error::None;
+	};
+
+	while(p < stop){
+		while((p < stop) && blank(*p)){ p += 1; }
+		if(p >= stop){ break; }
+
+		if(*p == '\n'){
+			p += 1;
+			continue;
+		}
+		if((*p == '#') || (*p == '%')){
+			skip_line();
+			continue;
+		}
+
+		u64 src = 0, dst = 0;
+		auto err = read_id(src);
+		Or_Return(err);
+		if((p >= stop) || !blank(*p)){ return edge_list_error::BadFormat; }
+		while((p < stop) && blank(*p)){ p += 1; }
+		err = read_id(dst);
+		Or_Return(err);
+
+		fn(u32(src), u32(dst));
+		skip_line();
+	}
+
+	return edge_list_error::None;
+}
+
+// Run fn(t) for every t in [0, thread_count), the calling thread takes t = 0
+template<typename Func>
+void run_threads(usize thread_count, Func&& fn){
+	auto threads = x::dynamic_array<std::thread>(x::std_heap_allocator(), thread_count);
+	for(usize t = 1; t < thread_count; t += 1){
+		threads.append(std::thread([&fn, t](){ fn(t); }));
+	}
+	fn(0);
+	for(auto& th : threads){
+		th.join();
+	}
+}
+
+// Split text into n ranges that start and end on line boundaries, some of
+// them empty when the text is short
+inline x::slice<chunk> split_lines(char const* text, usize size, usize n){
+	auto chunks = x::make_slice<chunk>(x::std_heap_allocator(), n);
+	usize begin = 0;
+	for(usize i = 0; i < n; i += 1){
+		auto end = (i + 1 == n) ? size : x::max(begin, (size / n) * (i + 1));
+		// Offset 0 is already the start of a line
+		while((end > 0) && (end < size) && (text[end - 1] != '\n')){ end += 1; }
+		chunks[i] = {begin, end};
+		begin = end;
+	}
+	return chunks;
+}
+
+// Per thread out-degree counters, grown as higher ids show up
+struct degree_counter {
+	x::slice<u32> counts;
+	usize max_id = 0;
+	bool any = false;
+	edge_list_error err = edge_list_error::None;
+
+	void add(u32 src, u32 dst){
+		if(src >= counts.size()){
+			auto new_size = x::max(usize(src) + 1, counts.size() * 2, usize(1024));
+			auto grown = x::make_slice<u32>(x::std_heap_allocator(), new_size);
+			for(usize i = 0; i < counts.size(); i += 1){
+				grown[i] = counts[i];
+			}
+			x::destroy(x::std_heap_allocator(), counts);
+			counts = grown;
+		}
+		counts[src] += 1;
+		max_id = x::max(max_id, usize(src), usize(dst));
+		any = true;
+	}
+};
+
+}
+
+// Build a csr_adjacency out of an edge list held in memory. The text is split
+// into chunks on line boundaries that are parsed in parallel twice: the first
+// pass counts out-degrees, the second writes every edge straight into its final
+// slot, so edges are never buffered. Neighbour lists are then sorted and
+// duplicates dropped. thread_count = 0 picks one based on the size. Lists with
+// more than max_nodes nodes fail with TooManyNodes, before anything is sized
+// after their ids.
+inline
+edge_list_error parse_edge_list(csr_adjacency& out, x::view<char> text, x::allocator al,
+	x::usize thread_count = 0, x::usize max_nodes = edge_list_max_nodes)
+{
+	using namespace edge_list_impl;
+	max_nodes = x::min(max_nodes, edge_list_max_nodes);
+	auto heap = x::std_heap_allocator();
+	auto data = text.raw_data();
+	auto size = text.size();
+
+	if(thread_count == 0){
+		auto hw = usize(x::max(std::thread::hardware_concurrency(), 1u));
+		thread_count = x::clamp(usize(1), size / min_chunk_size, hw);
+	}
+
+	auto chunks = split_lines(data, size, thread_count);
+	Defer(x::destroy(heap, chunks));
+	auto counters = x::make_slice<degree_counter>(heap, thread_count);
+	Defer({
+		for(auto& c : counters){ x::destroy(heap, c.counts); }
+		x::destroy(heap, counters);
+	});
+
+	// Count
+	run_threads(thread_count, [&](usize t){
+		auto& counter = counters[t];
+		counter.err = parse_lines(data, chunks[t].begin, chunks[t].end, max_nodes, [&](u32 src, u32 dst){
+			counter.add(src, dst);
+		});
+	});
+
+	usize node_count = 0;
+	for(auto& c : counters){
+		Or_Return(c.err);
+		if(c.any){ node_count = x::max(node_count, c.max_id + 1); }
+	}
+
+	// Offsets, and the slot every thread starts writing each node's edges
+	// at. Threads take a node's slots in chunk order, so the result does
+	// not depend on scheduling.
+	auto cursors = x::make_slice<x::slice<usize>>(heap, thread_count);
+	Defer({
+		for(auto& c : cursors){ x::destroy(heap, c); }
+		x::destroy(heap, cursors);
+	});
+	for(usize t = 0; t < thread_count; t += 1){
+		cursors[t] = x::make_slice<usize>(heap, counters[t].counts.size());
+	}
+
+	auto offsets = x::make_slice<usize>(al, node_count + 1);
+	for(usize v = 0; v < node_count; v += 1){
+		auto pos = offsets[v];
+		for(usize t = 0; t < thread_count; t += 1){
+			if(v >= cursors[t].size()){ continue; }
+			cursors[t][v] = pos;
+			pos += counters[t].counts[v];
+		}
+		offsets[v + 1] = pos;
+	}
+
+	// Fill
+	auto neighbors = x::make_slice<u32>(al, offsets[node_count]);
+	run_threads(thread_count, [&](usize t){
+		auto cursor = cursors[t];
+		parse_lines(data, chunks[t].begin, chunks[t].end, max_nodes, [&](u32 src, u32 dst){
+			neighbors[cursor[src]] = dst;
+			cursor[src] += 1;
+		});
+	});
+
+	// Sort and deduplicate every list in place, then close the gaps
+	auto unique_counts = x::make_slice<usize>(heap, node_count);
+	Defer(x::destroy(heap, unique_counts));
+	run_threads(thread_count, [&](usize t){
+		auto begin = (node_count / thread_count) * t;
+		auto end = (t + 1 == thread_count) ? node_count : (node_count / thread_count) * (t + 1);
+		for(usize v = begin; v < end; v += 1){
+			auto first = neighbors.raw_data() + offsets[v];
+			auto last  = neighbors.raw_data() + offsets[v + 1];
+			std::sort(first, last);
+			unique_counts[v] = usize(std::unique(first, last) - first);
+		}
+	});
+
+	usize e = 0;
+	for(usize v = 0; v < node_count; v += 1){
+		auto start = offsets[v];
+		offsets[v] = e;
+		for(usize i = 0; i < unique_counts[v]; i += 1){
+			neighbors[e + i] = neighbors[start + i];
+		}
+		e += unique_counts[v];
+	}
+	offsets[node_count] = e;
+
+	auto [packed, err] = x::make_slice_checked<u32>(al, e);
+	if(!x::error_ok(err)){ packed = neighbors.sub(0, e); }
+	else {
+		for(usize i = 0; i < e; i += 1){ packed[i] = neighbors[i]; }
+		x::destroy(al, neighbors);
+	}
+
+	out = csr_adjacency(al, offsets, packed);
+	return edge_list_error::None;
+}
+
+// Map a file and parse it with parse_edge_list()
+inline
+edge_list_error load_edge_list(csr_adjacency& out, char const* path, x::allocator al,
+	x::usize thread_count = 0, x::usize max_nodes = edge_list_max_nodes)
+{
+	auto file = mapped_file();
+	if(!x::error_ok(file.open(path))){
+		return edge_list_error::OpenFailed;
+	}
+	auto bytes = file.bytes();
+	auto text = x::view<char>(reinterpret_cast<char const*>(bytes.raw_data()), bytes.size());
+	return parse_edge_list(out, text, al, thread_count, max_nodes);
+}
+
+#endif /* Include guard */
@@ -2,123 +2,1228 @@
 #include "core.hpp"
 
 #include <cstdio>
-#include <queue>
+#include <thread>
+#include <atomic>
 
 #include "small_set.hpp"
-
-using x::dynamic_array, x::slice, x::view, x::pair, x::string;
-
-inline auto arena = x::arena_allocator(x::std_heap_allocator());
+#include "bit_matrix.hpp"
+#include "csr.hpp"
+#include "edge_list.hpp"
+#include "snapshot.hpp"
+#include "label_table.hpp"
+#include "radix_heap.hpp"
+#include "dynamic_closure.hpp"
+#include "reachability_index.hpp"
+#include "query_cache.hpp"
+#include "versioned_graph.hpp"
+
+using x::dynamic_array, x::slice, x::view, x::pair, x::string, x::hash_map;
+
+// Thread safe, so code on any thread may allocate from it. Its memory only
+// comes back with reset(), which batch mode calls after every command and the
+// interactive mode never does, so parallel_for_nodes() keeps its workers off it.
+inline auto arena = x::thread_arena_allocator(x::std_heap_allocator());
 constexpr
 inline auto default_allocator = arena.as_allocator();
 
-template<typename ListLike, typename CompFunc, typename U>
-pair<usize, bool> linear_search(ListLike const& list, U&& val, CompFunc&& fn){
-    for(usize i = 0; i < list.size(); i += 1){
-        if(fn(list[i], val)){
-            return {i, true};
-        }
+// Storage that grows with a graph is released as it grows, which the arena
+// cannot do, so it comes from the heap instead.
+inline auto storage_allocator = x::std_heap_allocator();
+
+// Nodes are dense 32-bit ids, so graphs only store and compare integers.
+// Labels are kept apart, in a label_table that maps them to ids and back.
+struct graph_node {
+	u32 id = label_table::none;
+
+	graph_node(){}
+
+	graph_node(u32 id)
+	: id{id} {}
+
+    bool operator==(graph_node const& node) const {
+        return id == node.id;
+    }
+    bool operator!=(graph_node const& node) const {
+        return !(id == node.id);
     }
-    return {0, false};
+};
+
+u64 hash(graph_node node){
+	return x::hash(u64(node.id));
 }
 
-isize next_unvisited(slice<bool> const& visit_list) {
-	for(usize i = 0; i < visit_list.size(); i += 1){
-		if(!visit_list[i]){ return i; }
+
+// Map every label to its position, repeated labels resolve to the first one
+void index_nodes(hash_map<graph_node, usize>& index, slice<graph_node> nodes){
+	for(usize i = 0; i < nodes.size(); i += 1){
+		if(!index.has(nodes[i])){
+			index.set(nodes[i], i);
+		}
 	}
-	return -1;
-};
+}
 
-isize next_unstudied(slice<i32> const& visit_list) {
-	for(usize i = 0; i < visit_list.size(); i += 1){
-		if(visit_list[i] != -1){ return i; }
+// Graph algorithms ////////////////////////////////////////////////////////////
+// Traversals are written once against node indices and shared by every graph
+// representation. A graph type only needs to provide:
+//   usize size() const
+//   void for_each_neighbor(usize node, Func&& fn) const
+//   isize next_neighbor(usize node, usize& cursor) const
+// next_neighbor() yields neighbours in ascending order and returns -1 once
+// they run out, the cursor must start out as 0. Weighted searches also need
+//   void for_each_weighted_neighbor(usize node, Func&& fn) const
+// which calls fn(neighbor, u32 weight).
+
+// Scratch memory for traversals, reusing one across queries avoids allocating
+// on every call. A workspace must not be shared between threads.
+//
+// Per node data is only meaningful for nodes stamped with the current epoch,
+// so starting a traversal bumps the epoch instead of clearing every array.
+struct traversal_workspace {
+	// Epoch of the last traversal that reached each node
+	slice<u32> stamps;
+	// Same as stamps, for the backward half of a bidirectional search
+	slice<u32> backward_stamps;
+	// Steps from the start of a breadth first search
+	slice<i32> levels;
+	// Node each node was reached from
+	slice<usize> parent;
+	// Node each node leads to when searching backwards from a target
+	slice<usize> next_hop;
+	// Nodes in the order a breadth first search reached them, every level
+	// of the search is a contiguous range of it.
+	x::queue<usize> frontier;
+	// Nodes reached by the backward half of a bidirectional search
+	x::queue<usize> backward_frontier;
+	// One bit per node, set for the nodes of the level being expanded
+	slice<u64> frontier_bits;
+	// Frames of a depth first search, the node of each one and the cursor
+	// of its next neighbour. There is at most one frame per node.
+	slice<usize> stack;
+	slice<usize> cursors;
+	// Nodes in the order a depth first search finished them
+	slice<usize> finish_order;
+
+	// Start a traversal over n nodes, which forgets everything the last one
+	// reached. O(1) unless the arrays have to grow or the epoch wraps.
+	void begin(usize n){
+		reserve(n);
+		if(epoch == ~u32(0)){
+			x::mem_set(stamps.raw_data(), 0, stamps.size() * sizeof(u32));
+			x::mem_set(backward_stamps.raw_data(), 0, backward_stamps.size() * sizeof(u32));
+			epoch = 0;
+		}
+		epoch += 1;
+		frontier.clear();
+		backward_frontier.clear();
 	}
-	return -1;
+
+	bool visited(usize node) const {
+		return stamps[node] == epoch;
+	}
+
+	void visit(usize node){
+		stamps[node] = epoch;
+	}
+
+	bool visited_backward(usize node) const {
+		return backward_stamps[node] == epoch;
+	}
+
+	void visit_backward(usize node){
+		backward_stamps[node] = epoch;
+	}
+
+	// Level of a node in the last breadth first search, -1 if unreached
+	i32 level(usize node) const {
+		return visited(node) ? levels[node] : -1;
+	}
+
+	traversal_workspace(x::allocator al)
+		: frontier(al, 0), backward_frontier(al, 0), backing_allocator{al} {}
+
+	traversal_workspace(traversal_workspace const&) = delete;
+	void operator=(traversal_workspace const&) = delete;
+
+	traversal_workspace(traversal_workspace&& ws)
+		: frontier{x::move(ws.frontier)},
+		backward_frontier{x::move(ws.backward_frontier)},
+		backing_allocator{ws.backing_allocator}
+	{
+		take(ws);
+	}
+
+	void operator=(traversal_workspace&& ws){
+		release();
+		frontier = x::move(ws.frontier);
+		backward_frontier = x::move(ws.backward_frontier);
+		backing_allocator = ws.backing_allocator;
+		take(ws);
+	}
+
+	~traversal_workspace(){
+		release();
+	}
+
+private:
+	void reserve(usize n){
+		if(stamps.size() >= n){ return; }
+		release();
+		stamps            = make_slice<u32>(backing_allocator, n);
+		backward_stamps   = make_slice<u32>(backing_allocator, n);
+		levels            = make_slice<i32>(backing_allocator, n);
+		parent            = make_slice<usize>(backing_allocator, n);
+		next_hop          = make_slice<usize>(backing_allocator, n);
+		frontier.resize_capacity(n);
+		backward_frontier.resize_capacity(n);
+		frontier_bits     = make_slice<u64>(backing_allocator, bit_matrix::words_for(n));
+		stack             = make_slice<usize>(backing_allocator, n);
+		cursors           = make_slice<usize>(backing_allocator, n);
+		finish_order      = make_slice<usize>(backing_allocator, n);
+		epoch = 0;
+	}
+
+	void take(traversal_workspace& ws){
+		stamps            = x::exchange(ws.stamps, slice<u32>{});
+		backward_stamps   = x::exchange(ws.backward_stamps, slice<u32>{});
+		levels            = x::exchange(ws.levels, slice<i32>{});
+		parent            = x::exchange(ws.parent, slice<usize>{});
+		next_hop          = x::exchange(ws.next_hop, slice<usize>{});
+		frontier_bits     = x::exchange(ws.frontier_bits, slice<u64>{});
+		stack             = x::exchange(ws.stack, slice<usize>{});
+		cursors           = x::exchange(ws.cursors, slice<usize>{});
+		finish_order      = x::exchange(ws.finish_order, slice<usize>{});
+		epoch             = x::exchange(ws.epoch, 0);
+	}
+
+	void release(){
+		x::destroy(backing_allocator, stamps);
+		x::destroy(backing_allocator, backward_stamps);
+		x::destroy(backing_allocator, levels);
+		x::destroy(backing_allocator, parent);
+		x::destroy(backing_allocator, next_hop);
+		x::destroy(backing_allocator, frontier_bits);
+		x::destroy(backing_allocator, stack);
+		x::destroy(backing_allocator, cursors);
+		x::destroy(backing_allocator, finish_order);
+	}
+
+	x::allocator backing_allocator;
+	u32 epoch = 0;
 };
 
-template<typename T>
-void slice_remove_ordered(slice<T>& s, usize idx){
-	if(idx != (s.size() - 1)){
-		for(usize i = idx; i < (s.size() - 1); i += 1){
-			x::swap(s[i], s[i+1]);
+// Depth first search from start through nodes the current traversal has not
+// visited yet, taking neighbours in ascending order. Every frame keeps a cursor
+// into the neighbour list of its node, so there are never more than V frames
+// and each edge is looked at once. Nodes are appended to ws.frontier when
+// entered (pre-order) and to ws.finish_order when left (post-order), leaving
+// also marks them with visit_backward(). Returns whether an edge led back to a
+// node that was entered but not left yet, that is whether there is a cycle.
+template<typename Graph>
+bool depth_first_tree(Graph const& g, usize start, traversal_workspace& ws){
+	// Every tree before this one is done, so both orders are as long
+	usize post_count = ws.frontier.size();
+	usize depth = 0;
+	bool cycle = false;
+
+	auto enter = [&](usize node){
+		ws.visit(node);
+		ws.frontier.push(node);
+		ws.stack[depth] = node;
+		ws.cursors[depth] = 0;
+		depth += 1;
+	};
+
+	enter(start);
+	while(depth > 0){
+		auto cur = ws.stack[depth - 1];
+		auto adj = g.next_neighbor(cur, ws.cursors[depth - 1]);
+
+		if(adj < 0){
+			ws.visit_backward(cur);
+			ws.finish_order[post_count] = cur;
+			post_count += 1;
+			depth -= 1;
+		}
+		else if(!ws.visited(adj)){
+			enter(adj);
+		}
+		else if(!ws.visited_backward(adj)){
+			cycle = true;
 		}
 	}
 
-	s = s.sub(0, s.size() - 1);
+	return cycle;
 }
 
-struct graph_node {
-	char label = 0;
+// Depth first search from start. Returns how many nodes were visited,
+// ws.frontier holds them in pre-order and ws.finish_order in post-order.
+template<typename Graph>
+usize depth_first_trail(Graph const& g, usize start, traversal_workspace& ws){
+	ws.begin(g.size());
+	depth_first_tree(g, start, ws);
+	return ws.frontier.size();
+}
 
-	graph_node(){}
+// Depth first search over the whole graph, a new tree starts from the lowest
+// unvisited node whenever the last one is done. Pre-order and post-order of
+// every node end up in ws.frontier and ws.finish_order. Returns whether the
+// graph has a cycle, when it does not the reverse of the post-order is a
+// topological order.
+template<typename Graph>
+bool depth_first_forest(Graph const& g, traversal_workspace& ws){
+	ws.begin(g.size());
+	bool cycle = false;
+	for(usize node = 0; node < g.size(); node += 1){
+		if(!ws.visited(node)){
+			cycle |= depth_first_tree(g, node, ws);
+		}
+	}
+	return cycle;
+}
 
-	graph_node(char label)
-	: label{label} {}
+// Breadth first search from start through a plain queue, taking neighbours in
+// ascending order. Returns how many nodes were reached, ws.frontier holds them
+// in the order they were reached and ws.level() the number of steps needed to
+// reach each one.
+template<typename Graph>
+usize breadth_first_trail(Graph const& g, usize start, traversal_workspace& ws){
+	ws.begin(g.size());
+	auto& queue = ws.frontier;
+	queue.push(start);
+	ws.levels[start] = 0;
+	ws.visit(start);
+
+	for(usize i = 0; i < queue.size(); i += 1){
+		auto cur = queue[i];
+		g.for_each_neighbor(cur, [&](usize adj){
+			if(!ws.visited(adj)){
+				ws.visit(adj);
+				ws.levels[adj] = ws.levels[cur] + 1;
+				queue.push(adj);
+			}
+		});
+	}
 
-    bool operator==(graph_node const& node) const {
-        return label == node.label;
-    }
-    bool operator!=(graph_node const& node) const {
-        return !(label == node.label);
-    }
+	return queue.size();
+}
+
+// Breadth first search from start, nothing is allocated once the workspace is
+// big enough. Returns how many nodes were reached, ws.frontier holds them
+// level by level and ws.level() the number of steps needed to reach each one.
+//
+// The search is direction optimizing (Beamer et al.): small frontiers are
+// expanded top down through their out edges, once the edges leaving the
+// frontier outnumber a fraction of the unexplored ones every unreached node
+// instead looks for a parent inside the frontier bitmap through its in edges,
+// stopping at the first one. On low diameter graphs this skips most of the
+// edges the middle levels would otherwise inspect. Levels are the same either
+// way, but nodes found bottom up come out in index order within their level,
+// and when the search switches depends on the edge and node counts. Visiting
+// orders therefore come from breadth_first_trail(), this is for levels only.
+//
+// Besides the basic interface this needs from the graph:
+//   usize edge_count() const
+//   usize degree(usize node) const
+//   isize next_in_neighbor(usize node, usize& cursor) const
+template<typename Graph>
+usize breadth_first_levels(Graph const& g, usize start, traversal_workspace& ws){
+	// Switch to bottom up once the frontier has more than 1/alpha of the
+	// unexplored edges, back to top down once it holds less than 1/beta
+	// of the nodes and stopped growing.
+	constexpr usize alpha = 15;
+	constexpr usize beta  = 18;
+
+	auto n = g.size();
+	ws.begin(n);
+
+	// Nothing is popped, the queue keeps the whole visiting order and the
+	// level being expanded is the range [begin, end) of it.
+	auto levels = ws.levels;
+	auto& queue = ws.frontier;
+	auto bits  = ws.frontier_bits;
+	usize begin = 0;
+	usize end   = 1;
+	i32 depth   = 0;
+
+	queue.push(start);
+	levels[start] = 0;
+	ws.visit(start);
+
+	auto edges_to_check = g.edge_count();
+	auto scout_count    = g.degree(start);
+
+	auto top_down_step = [&](){
+		usize scout = 0;
+		for(usize i = begin; i < end; i += 1){
+			g.for_each_neighbor(queue[i], [&](usize adj){
+				if(!ws.visited(adj)){
+					ws.visit(adj);
+					levels[adj] = depth + 1;
+					queue.push(adj);
+					scout += g.degree(adj);
+				}
+			});
+		}
+		return scout;
+	};
+
+	auto bottom_up_step = [&](){
+		x::mem_set(bits.raw_data(), 0, bits.size() * sizeof(u64));
+		for(usize i = begin; i < end; i += 1){
+			auto v = queue[i];
+			bits[v / 64] |= u64(1) << (v % 64);
+		}
+
+		usize awake = 0;
+		for(usize v = 0; v < n; v += 1){
+			if(ws.visited(v)){ continue; }
+
+			usize cursor = 0;
+			for(auto u = g.next_in_neighbor(v, cursor); u >= 0; u = g.next_in_neighbor(v, cursor)){
+				if((bits[u / 64] >> (u % 64)) & 1){
+					ws.visit(v);
+					levels[v] = depth + 1;
+					queue.push(v);
+					awake += 1;
+					break;
+				}
+			}
+		}
+		return awake;
+	};
+
+	while(begin < end){
+		if(scout_count > (edges_to_check / alpha)){
+			auto awake = end - begin;
+			usize old_awake = 0;
+			do {
+				old_awake = awake;
+				awake = bottom_up_step();
+				begin = end;
+				end   = queue.size();
+				depth += 1;
+			} while((awake >= old_awake) || (awake > (n / beta)));
+			scout_count = 1;
+		}
+		else {
+			edges_to_check -= x::min(scout_count, edges_to_check);
+			scout_count = top_down_step();
+			begin = end;
+			end   = queue.size();
+			depth += 1;
+		}
+	}
+
+	return queue.size();
+}
+
+// Threads worth using for a job with one task per node, small graphs stay on
+// the calling thread.
+usize parallel_thread_count(usize n){
+	constexpr usize min_nodes_per_thread = 256;
+	auto hw = usize(x::max(std::thread::hardware_concurrency(), 1u));
+	return x::clamp(usize(1), n / min_nodes_per_thread, hw);
+}
+
+// Call fn(i, ws) for every i in [0, n) over thread_count threads, the calling
+// thread included. Each thread gets its own workspace in a scoped arena that
+// is freed when the thread is done. Taking the workspaces from the global
+// arena would also work, but they would then stay around until its next
+// reset, which can be never.
+template<typename Func>
+void parallel_for_nodes(usize n, usize thread_count, Func&& fn){
+	constexpr usize chunk = 16;
+	auto next = std::atomic<usize>(0);
+
+	auto worker = [&](){
+		auto local_arena = x::arena_allocator(x::std_heap_allocator());
+		auto ws = traversal_workspace(local_arena.as_allocator());
+		while(1){
+			auto begin = next.fetch_add(chunk);
+			if(begin >= n){ break; }
+			auto end = x::min(begin + chunk, n);
+			for(usize i = begin; i < end; i += 1){
+				fn(i, ws);
+			}
+		}
+	};
+
+	auto threads = dynamic_array<std::thread>(default_allocator, thread_count);
+	for(usize i = 1; i < thread_count; i += 1){
+		threads.append(std::thread(worker));
+	}
+	worker();
+	for(auto& t : threads){
+		t.join();
+	}
+}
+
+// Steps from every node to every other, -1 when unreachable. One breadth first
+// search runs per source, spread over thread_count threads (0 picks a count
+// based on the graph size). The result does not depend on the thread count.
+template<typename Graph>
+slice<slice<i32>> reachability_levels(Graph const& g, usize thread_count = 0){
+	auto n = g.size();
+	auto mat = x::make_slice<slice<i32>>(default_allocator, n);
+	for(auto& row : mat){
+		row = x::make_slice<i32>(default_allocator, n);
+	}
+
+	if(thread_count == 0){
+		thread_count = parallel_thread_count(n);
+	}
+
+	parallel_for_nodes(n, thread_count, [&](usize node, traversal_workspace& ws){
+		breadth_first_levels(g, node, ws);
+		for(usize i = 0; i < n; i += 1){
+			mat[node][i] = ws.level(i);
+		}
+	});
+
+	return mat;
+}
+
+// Strongly connected component id of every node and the number of
+// components, found with an iterative version of Tarjan's algorithm in O(V+E)
+// time and O(V) extra memory. Ids come out in reverse topological order: an
+// edge between two different components always goes from a higher id to a
+// lower one.
+template<typename Graph>
+pair<slice<usize>, usize> tarjan_components(Graph const& g){
+	constexpr auto unvisited = ~usize(0);
+	auto n = g.size();
+	if(n == 0){ return {{}, 0}; }
+
+	struct frame {
+		usize node;
+		usize cursor;
+	};
+
+	auto order    = make_slice<usize>(default_allocator, n);
+	auto low      = make_slice<usize>(default_allocator, n);
+	auto comp     = make_slice<usize>(default_allocator, n);
+	auto on_stack = make_slice<bool>(default_allocator, n);
+	auto pending  = x::stack<usize>(default_allocator);
+	auto calls    = x::stack<frame>(default_allocator);
+
+	for(auto& o : order){ o = unvisited; }
+
+	usize counter = 0;
+	usize comp_count = 0;
+
+	auto discover = [&](usize v){
+		order[v] = counter;
+		low[v] = counter;
+		counter += 1;
+		pending.push(v);
+		on_stack[v] = true;
+		calls.push(frame{v, 0});
+	};
+
+	for(usize root = 0; root < n; root += 1){
+		if(order[root] != unvisited){ continue; }
+		discover(root);
+
+		while(!calls.empty()){
+			auto v = calls.top().node;
+			auto w = g.next_neighbor(v, calls.top().cursor);
+
+			if(w >= 0){
+				if(order[w] == unvisited){
+					discover(w);
+				}
+				else if(on_stack[w]){
+					low[v] = x::min(low[v], order[w]);
+				}
+				continue;
+			}
+
+			// All neighbours done, v is the root of a component if nothing
+			// below it reached further up the stack.
+			if(low[v] == order[v]){
+				while(1){
+					auto u = pending.top();
+					pending.pop();
+					on_stack[u] = false;
+					comp[u] = comp_count;
+					if(u == v){ break; }
+				}
+				comp_count += 1;
+			}
+
+			calls.pop();
+			if(!calls.empty()){
+				auto parent = calls.top().node;
+				low[parent] = x::min(low[parent], low[v]);
+			}
+		}
+	}
+
+	return {comp, comp_count};
+}
+
+// Groups of mutually reachable nodes in O(V+E). Groups are ordered by their
+// smallest node and each group is in ascending index order.
+template<typename Graph>
+slice<slice<usize>> strongly_connected_components(Graph const& g){
+	constexpr auto unvisited = ~usize(0);
+	auto n = g.size();
+	auto [comp, comp_count] = tarjan_components(g);
+
+	// Renumber components by their smallest node, then bucket the nodes
+	auto group_of = make_slice<usize>(default_allocator, comp_count);
+	auto offsets  = make_slice<usize>(default_allocator, comp_count + 1);
+	for(auto& gr : group_of){ gr = unvisited; }
+
+	usize groups = 0;
+	for(usize v = 0; v < n; v += 1){
+		auto& gr = group_of[comp[v]];
+		if(gr == unvisited){
+			gr = groups;
+			groups += 1;
+		}
+		offsets[gr + 1] += 1;
+	}
+	for(usize i = 1; i < offsets.size(); i += 1){
+		offsets[i] += offsets[i - 1];
+	}
+
+	auto members = make_slice<usize>(default_allocator, n);
+	auto components = make_slice<slice<usize>>(default_allocator, comp_count);
+	for(usize i = 0; i < comp_count; i += 1){
+		components[i] = members.sub(offsets[i], offsets[i + 1]);
+	}
+	for(usize v = 0; v < n; v += 1){
+		auto& pos = offsets[group_of[comp[v]]];
+		members[pos] = v;
+		pos += 1;
+	}
+
+	return components;
+}
+
+// Transitive closure as a bit matrix: bit (i, j) is set when j != i can be
+// reached from i. Components are processed sinks first, so every component
+// only has to OR in the finished rows of the components it points to, which
+// costs O(V+E) plus V/64 words per edge between components.
+template<typename Graph>
+bit_matrix reachability_bits(Graph const& g){
+	constexpr auto unvisited = ~usize(0);
+	auto n = g.size();
+	auto [comp, comp_count] = tarjan_components(g);
+
+	// Nodes of each component
+	auto offsets = make_slice<usize>(default_allocator, comp_count + 1);
+	for(usize v = 0; v < n; v += 1){
+		offsets[comp[v] + 1] += 1;
+	}
+	for(usize i = 1; i < offsets.size(); i += 1){
+		offsets[i] += offsets[i - 1];
+	}
+	auto members = make_slice<usize>(default_allocator, n);
+	auto fill = make_slice<usize>(default_allocator, comp_count);
+	for(usize v = 0; v < n; v += 1){
+		auto c = comp[v];
+		members[offsets[c] + fill[c]] = v;
+		fill[c] += 1;
+	}
+
+	// Row c holds every node reachable from component c. Inside of a
+	// component with a cycle every member has an incoming edge from another
+	// member, so the members get added by the direct edges alone.
+	auto comp_reach = bit_matrix(storage_allocator, n);
+	auto merged = make_slice<usize>(default_allocator, comp_count);
+	for(auto& m : merged){ m = unvisited; }
+
+	for(usize c = 0; c < comp_count; c += 1){
+		auto reach = comp_reach.row(c);
+		for(usize i = offsets[c]; i < offsets[c + 1]; i += 1){
+			g.for_each_neighbor(members[i], [&](usize w){
+				reach[w / bit_matrix::word_bits] |= u64(1) << (w % bit_matrix::word_bits);
+				auto cw = comp[w];
+				if((cw != c) && (merged[cw] != c)){
+					merged[cw] = c;
+					bit_or(reach, comp_reach.row(cw));
+				}
+			});
+		}
+	}
+
+	auto res = bit_matrix(storage_allocator, n);
+	for(usize v = 0; v < n; v += 1){
+		auto row = res.row(v);
+		x::mem_copy(row.raw_data(), comp_reach.row(comp[v]).raw_data(), row.size() * sizeof(u64));
+		res.set(v, v, false);
+	}
+
+	return res;
+}
+
+template<typename Graph>
+slice<slice<bool>> reachability_bool(Graph const& g){
+	auto bits = reachability_bits(g);
+	auto bmat = make_slice<slice<bool>>(default_allocator, g.size());
+	for(usize i = 0; i < bmat.size(); i += 1){
+		bmat[i] = make_slice<bool>(default_allocator, g.size());
+		bits.for_each_in_row(i, [&](usize j){
+			bmat[i][j] = true;
+		});
+	}
+
+	return bmat;
+}
+
+// Length of the shortest path from start to every node, -1 where there is
+// none, with Dijkstra's algorithm. Weights are unsigned, so popped distances
+// never go down and the queue can be a radix_heap: O(E + V log C) for a longest
+// distance C instead of O((V + E) log V) with a binary heap. Stale queue
+// entries are skipped when popped rather than updated in place.
+template<typename Graph>
+slice<i64> shortest_distances(Graph const& g, usize start){
+	constexpr auto unreached = ~u64(0);
+	auto n = g.size();
+	auto dist = make_slice<u64>(default_allocator, n);
+	Defer(x::destroy(default_allocator, dist));
+	for(auto& d : dist){ d = unreached; }
+
+	auto heap = radix_heap<u32>(default_allocator);
+	dist[start] = 0;
+	heap.push(0, u32(start));
+
+	while(!heap.empty()){
+		auto [d, u] = heap.pop();
+		if(d != dist[u]){ continue; }
+
+		g.for_each_weighted_neighbor(u, [&](usize v, u32 w){
+			auto nd = d + w;
+			if(nd < dist[v]){
+				dist[v] = nd;
+				heap.push(nd, u32(v));
+			}
+		});
+	}
+
+	auto res = make_slice<i64>(default_allocator, n);
+	for(usize i = 0; i < n; i += 1){
+		res[i] = (dist[i] == unreached) ? -1 : i64(dist[i]);
+	}
+	return res;
+}
+
+enum struct path_mode : i32 {
+	// First path found by a depth first search that takes neighbours in
+	// ascending order
+	DepthFirst = 0,
+	// Path with the least number of edges
+	BreadthFirst,
+	// Path with the least number of edges, searching forwards from the
+	// start and backwards from the target until both sides meet. Explores
+	// about O(b^(d/2)) nodes instead of O(b^d) on low diameter graphs, but
+	// needs next_in_neighbor() from the graph.
+	Bidirectional,
 };
 
+// Breadth first search that alternates between expanding the smaller of two
+// frontiers, one going forward from start through out edges and one going
+// backward from target through in edges. Returns the node where they met, -1
+// if there is no path. Whole levels are expanded at a time, so the first
+// meeting point is on a shortest path. The workspace must have been started
+// with start already visited.
+template<typename Graph>
+isize bidirectional_meet(Graph const& g, usize start, usize target, traversal_workspace& ws){
+	auto& forward  = ws.frontier;
+	auto& backward = ws.backward_frontier;
+	forward.push(start);
+	backward.push(target);
+	ws.visit_backward(target);
+
+	if(start == target){ return isize(start); }
+
+	while(!forward.empty() && !backward.empty()){
+		// Each pass pops exactly the nodes of one level
+		if(forward.size() <= backward.size()){
+			for(usize level = forward.size(); level > 0; level -= 1){
+				auto cur = forward.front();
+				forward.pop();
+				usize cursor = 0;
+				for(auto adj = g.next_neighbor(cur, cursor); adj >= 0; adj = g.next_neighbor(cur, cursor)){
+					if(ws.visited(adj)){ continue; }
+					ws.visit(adj);
+					ws.parent[adj] = cur;
+					if(ws.visited_backward(adj)){ return adj; }
+					forward.push(adj);
+				}
+			}
+		}
+		else {
+			for(usize level = backward.size(); level > 0; level -= 1){
+				auto cur = backward.front();
+				backward.pop();
+				usize cursor = 0;
+				for(auto adj = g.next_in_neighbor(cur, cursor); adj >= 0; adj = g.next_in_neighbor(cur, cursor)){
+					if(ws.visited_backward(adj)){ continue; }
+					ws.visit_backward(adj);
+					ws.next_hop[adj] = cur;
+					if(ws.visited(adj)){ return adj; }
+					backward.push(adj);
+				}
+			}
+		}
+	}
+
+	return -1;
+}
+
+// Path from start to target, both included, empty if there is none. Runs in
+// O(V+E) without recursion and without allocating once the workspace is big
+// enough. The result points into the workspace, so it is only valid until the
+// workspace is used again.
+template<typename Graph>
+view<usize> find_path_into(Graph const& g, usize start, usize target, path_mode mode, traversal_workspace& ws){
+	ws.begin(g.size());
+
+	// Paths are written to the frame stack, it is as long as the graph
+	auto nodes = ws.stack;
+	ws.visit(start);
+	ws.parent[start] = start;
+
+	if(mode == path_mode::DepthFirst){
+		// The stack of (node, cursor) frames is the path to its top
+		auto stack = nodes;
+		auto cursors = ws.cursors;
+		stack[0] = start;
+		cursors[0] = 0;
+		usize depth = 1;
+
+		while(depth > 0){
+			if(stack[depth - 1] == target){
+				return view<usize>(stack).sub(0, depth);
+			}
+
+			auto cur = stack[depth - 1];
+			auto adj = g.next_neighbor(cur, cursors[depth - 1]);
+			if(adj < 0){
+				depth -= 1;
+				continue;
+			}
+			if(ws.visited(adj)){ continue; }
+
+			ws.visit(adj);
+			ws.parent[adj] = cur;
+			stack[depth] = adj;
+			cursors[depth] = 0;
+			depth += 1;
+		}
+		return {};
+	}
 
+	if(mode == path_mode::Bidirectional){
+		auto meet = bidirectional_meet(g, start, target, ws);
+		if(meet < 0){ return {}; }
+
+		usize length = 1;
+		for(auto n = usize(meet); n != start; n = ws.parent[n]){
+			length += 1;
+		}
+		auto head_length = length;
+		for(auto n = usize(meet); n != target; n = ws.next_hop[n]){
+			length += 1;
+		}
+
+		// Start to the meeting point from parents, the rest from next hops
+		auto n = usize(meet);
+		for(usize i = head_length; i > 0; i -= 1){
+			nodes[i - 1] = n;
+			n = ws.parent[n];
+		}
+		n = usize(meet);
+		for(usize i = head_length; i < length; i += 1){
+			n = ws.next_hop[n];
+			nodes[i] = n;
+		}
+		return view<usize>(nodes).sub(0, length);
+	}
+
+	auto& queue = ws.frontier;
+	queue.push(start);
+
+	while(!queue.empty() && !ws.visited(target)){
+		auto cur = queue.front();
+		queue.pop();
+		g.for_each_neighbor(cur, [&](usize adj){
+			if(!ws.visited(adj)){
+				ws.visit(adj);
+				ws.parent[adj] = cur;
+				queue.push(adj);
+			}
+		});
+	}
+	if(!ws.visited(target)){ return {}; }
+
+	// Walk the parents back from the target
+	usize length = 1;
+	for(auto n = target; n != start; n = ws.parent[n]){
+		length += 1;
+	}
+	auto n = target;
+	for(usize i = length; i > 0; i -= 1){
+		nodes[i - 1] = n;
+		n = ws.parent[n];
+	}
+	return view<usize>(nodes).sub(0, length);
+}
+
+// Labeled queries /////////////////////////////////////////////////////////////
+// The graph types answer queries in terms of graph_node labels, written once
+// here on top of the index based algorithms. Besides the traversal interface
+// a labeled graph provides:
+//   isize index_of(graph_node node) const
+//   graph_node label_index(usize index) const
+//   bool alive(usize index) const
+//   usize node_count() const
+//   traversal_workspace workspace, the scratch memory of its queries
+
+// Labels of the first count nodes of a traversal
+template<typename Graph>
+slice<graph_node> label_trail(Graph const& g, x::queue<usize> const& trail, usize count){
+	auto labeled = make_slice<graph_node>(default_allocator, count);
+	for(usize i = 0; i < count; i += 1){
+		labeled[i] = g.label_index(trail[i]);
+	}
+	return labeled;
+}
+
+// Visiting order of a breadth or depth first search from start_node, listed
+// backwards: the last node reached comes first and start_node last.
+template<typename Graph>
+slice<graph_node> labeled_search(Graph const& g, graph_node start_node, bool breadth_first){
+	auto start = g.index_of(start_node);
+	if(start < 0){ return {}; }
+
+	auto count = breadth_first ? breadth_first_trail(g, start, g.workspace) : depth_first_trail(g, start, g.workspace);
+	auto labeled = label_trail(g, g.workspace.frontier, count);
+	for(usize i = 0; i < (labeled.size() / 2); i += 1){
+		x::swap(labeled[i], labeled[labeled.size() - (i + 1)]);
+	}
+	return labeled;
+}
+
+template<typename Graph>
+slice<graph_node> labeled_path(Graph const& g, graph_node start, graph_node target, path_mode mode){
+	auto start_idx = g.index_of(start);
+	auto target_idx = g.index_of(target);
+	if((start_idx < 0) || (target_idx < 0)){ return {}; }
+
+	auto path = find_path_into(g, start_idx, target_idx, mode, g.workspace);
+
+	auto labeled = make_slice<graph_node>(default_allocator, path.size());
+	for(usize i = 0; i < labeled.size(); i += 1){
+		labeled[i] = g.label_index(path[i]);
+	}
+	return labeled;
+}
+
+// value(i) of every live node i, in slot order
+template<typename T, typename Graph, typename Func>
+slice<pair<graph_node, T>> label_live(Graph const& g, Func&& value){
+	auto res = x::make_slice<pair<graph_node, T>>(default_allocator, g.node_count());
+	usize n = 0;
+	for(usize i = 0; i < g.size(); i += 1){
+		if(!g.alive(i)){ continue; }
+		res[n] = {g.label_index(i), value(i)};
+		n += 1;
+	}
+	return res;
+}
+
+// Steps from start_node to each live node, -1 where there is no path
+template<typename Graph>
+slice<pair<graph_node, i32>> labeled_levels(Graph const& g, graph_node start_node){
+	auto start = g.index_of(start_node);
+	if(start < 0){ return {}; }
+
+	breadth_first_levels(g, start, g.workspace);
+	return label_live<i32>(g, [&](usize i){ return g.workspace.level(i); });
+}
+
+// Weighted distance from start_node to each live node, -1 where there is no
+// path
+template<typename Graph>
+slice<pair<graph_node, i64>> labeled_distances(Graph const& g, graph_node start_node){
+	auto start = g.index_of(start_node);
+	if(start < 0){ return {}; }
+
+	auto dist = shortest_distances(g, start);
+	Defer(x::destroy(default_allocator, dist));
+	return label_live<i64>(g, [&](usize i){ return dist[i]; });
+}
+
+// Strongly connected subgraphs, ordered by their lowest slot. The nodes of
+// each one are listed from the highest slot down.
+template<typename Graph>
+slice<slice<graph_node>> labeled_components(Graph const& g){
+	auto components = strongly_connected_components(g);
+	auto subgraphs = dynamic_array<slice<graph_node>>(default_allocator, components.size() + 1);
+	for(auto comp : components){
+		// Dead slots are isolated, so they always end up alone
+		if(!g.alive(comp[0])){ continue; }
+		auto labeled = make_slice<graph_node>(default_allocator, comp.size());
+		for(usize i = 0; i < comp.size(); i += 1){
+			labeled[i] = g.label_index(comp[comp.size() - (i + 1)]);
+		}
+		subgraphs.append(labeled);
+	}
+	return subgraphs.extract_data();
+}
+
+// Live nodes ordered so that every edge goes from an earlier node to a later
+// one, the reverse of the finish order of a depth first forest. Empty when
+// the graph has a cycle.
+template<typename Graph>
+slice<graph_node> labeled_topological_order(Graph const& g){
+	if(depth_first_forest(g, g.workspace)){ return {}; }
+
+	auto order = make_slice<graph_node>(default_allocator, g.node_count());
+	usize n = 0;
+	for(usize i = g.size(); i > 0; i -= 1){
+		auto node = g.workspace.finish_order[i - 1];
+		if(!g.alive(node)){ continue; }
+		order[n] = g.label_index(node);
+		n += 1;
+	}
+	return order;
+}
+
+// Whether b can be reached from a through a reachability_index of g, which
+// is built first if it does not cover g
+template<typename Graph>
+bool indexed_reachable(Graph const& g, reachability_index& index, graph_node a, graph_node b){
+	auto idx_a = g.index_of(a);
+	auto idx_b = g.index_of(b);
+	if((idx_a < 0) || (idx_b < 0)){ return false; }
+
+	if(index.size() != g.size()){
+		auto [comp, comp_count] = tarjan_components(g);
+		Defer(x::destroy(default_allocator, comp));
+		index.build(g, comp, comp_count);
+	}
+	return index.reachable(idx_a, idx_b);
+}
+
+// Adjacency matrix of a graph. Deleting a node only leaves a tombstone in its
+// slot, which is reused by the next add_node(). Dead slots have no edges, so
+// traversals never reach them, but code that walks every slot must check
+// alive(). Once too many slots are dead, the matrix is compacted.
 struct connectivity_matrix {
-	using row = slice<bool>;
 	using path = slice<graph_node>;
-	slice<graph_node> node_map;
-	slice<row> rows;
+	// Compact once more than 1/compact_ratio of the slots are dead
+	static constexpr usize compact_ratio = 4;
+	// Memory kept for the closures of single nodes
+	static constexpr usize closure_cache_budget = 16 * x::prefix::mebi;
+
+	dynamic_array<graph_node> node_map;
+	dynamic_array<bool> alive_slots;
+	dynamic_array<usize> free_slots;
+	hash_map<graph_node, usize> node_index;
+	bit_matrix adjacency;
+	// Transpose of adjacency, row i holds the nodes with an edge into i
+	bit_matrix reverse_adjacency;
+	// Weights of the edges that do not weigh 1. Keys are made of node ids
+	// rather than slots (edge_key()), so compaction leaves them alone.
+	hash_map<u64, u32> edge_weights;
+	// Only maintained after track_reachability()
+	dynamic_closure closure;
+	usize edge_total = 0;
+	// Scratch memory of the search queries, which therefore must not run
+	// concurrently on the same graph.
+	mutable traversal_workspace workspace;
+	// Bumped by every change to the nodes, edges or weights
+	u64 version = 0;
+	// Results of queries at cached_version, see sync_cache(). Hits hand out
+	// copies, so they cost O(result) rather than O(1). The index is built by
+	// the first reachable() query.
+	mutable u64 cached_version = 0;
+	mutable reachability_index reach_index;
+	mutable lru_cache<graph_node, pair<graph_node, i32>> closure_cache;
+	mutable cached_rows<i32> reachability_cache;
+	mutable cached_rows<graph_node> components_cache;
+
+	// Number of slots, including dead ones
+	usize size() const {
+		return adjacency.size();
+	}
 
-	isize index_of(graph_node node) const {
-		for(usize i = 0; i < node_map.size(); i += 1){
-			if(node_map[i] == node){ return isize(i); }
+	// Number of live nodes
+	usize node_count() const {
+		return size() - free_slots.size();
+	}
+
+	bool alive(usize idx) const {
+		return alive_slots[idx];
+	}
+
+	// Live nodes, in slot order
+	[[nodiscard]]
+	slice<graph_node> live_nodes() const {
+		auto nodes = make_slice<graph_node>(default_allocator, node_count());
+		usize n = 0;
+		for(usize i = 0; i < size(); i += 1){
+			if(alive(i)){
+				nodes[n] = node_map[i];
+				n += 1;
+			}
 		}
-		return -1;
+		return nodes;
 	}
 
-	void add_node(graph_node node) {
-		for(auto e : node_map){
-			if(e == node){ return; }
+	template<typename Func>
+	void for_each_neighbor(usize node, Func&& fn) const {
+		adjacency.for_each_in_row(node, x::forward<Func>(fn));
+	}
+
+	isize next_neighbor(usize node, usize& cursor) const {
+		auto n = adjacency.next_in_row(node, cursor);
+		if(n >= 0){ cursor = n + 1; }
+		return n;
+	}
+
+	isize next_in_neighbor(usize node, usize& cursor) const {
+		auto n = reverse_adjacency.next_in_row(node, cursor);
+		if(n >= 0){ cursor = n + 1; }
+		return n;
+	}
+
+	template<typename Func>
+	void for_each_weighted_neighbor(usize node, Func&& fn) const {
+		if(edge_weights.empty()){
+			adjacency.for_each_in_row(node, [&](usize adj){ fn(adj, u32(1)); });
+			return;
 		}
-		auto new_map = make_slice<graph_node>(default_allocator, node_map.size() + 1);
-		new_map[new_map.size() - 1] = node;
+		auto from = node_map[node];
+		adjacency.for_each_in_row(node, [&](usize adj){
+			auto [w, ok] = edge_weights.get(edge_key(from, node_map[adj]));
+			fn(adj, ok ? w : u32(1));
+		});
+	}
 
-		// Update map
-		x::slice_copy(new_map, node_map);
-		node_map = new_map;
+	usize degree(usize node) const {
+		return adjacency.count_in_row(node);
+	}
 
-		// Update previous rows
-		for(usize i = 0; i < rows.size(); i += 1){
-			auto row = rows[i];
-			auto new_row = make_slice<bool>(default_allocator, row.size() + 1);
-			x::slice_copy(new_row, row);
-			new_row[new_row.size() - 1] = false;
-			rows[i] = new_row;
+	usize edge_count() const {
+		return edge_total;
+	}
+
+	isize index_of(graph_node node) const {
+		auto [idx, ok] = node_index.get(node);
+		return ok ? isize(idx) : -1;
+	}
+
+	void add_node(graph_node node) {
+		if(node_index.has(node)){ return; }
+		version += 1;
+
+		// Reuse a dead slot, its row and column were cleared on deletion
+		if(!free_slots.empty()){
+			auto idx = free_slots[free_slots.size() - 1];
+			free_slots.pop();
+			node_map[idx] = node;
+			alive_slots[idx] = true;
+			node_index.set(node, idx);
+			if(closure.enabled()){ closure.add_node(idx); }
+			return;
 		}
 
-		// Add new row
-		auto new_rows = make_slice<slice<bool>>(default_allocator, rows.size() + 1);
-		auto new_row = make_slice<bool>(default_allocator, new_rows.size());
-		for(auto& c : new_row){ c = false; }
+		// Rows and columns are reserved ahead of time, so this only
+		// reallocates once the capacity runs out.
+		auto err = adjacency.resize(adjacency.size() + 1);
+		if(!x::error_ok(err)){ return; }
+		err = reverse_adjacency.resize(reverse_adjacency.size() + 1);
+		if(!x::error_ok(err)){
+			adjacency.resize(adjacency.size() - 1);
+			return;
+		}
+		if(closure.enabled()){
+			err = closure.resize(adjacency.size());
+			if(!x::error_ok(err)){
+				adjacency.resize(adjacency.size() - 1);
+				reverse_adjacency.resize(reverse_adjacency.size() - 1);
+				return;
+			}
+		}
 
-		x::slice_copy(new_rows, rows);
-		new_rows[new_rows.size() - 1] = new_row;
-		rows = new_rows;
+		node_map.append(node);
+		alive_slots.append(true);
+		node_index.set(node, node_map.size() - 1);
 	}
 
 	void del_node(graph_node node) {
 		isize idx = index_of(node);
 		if(idx < 0){ return; }
 
-		slice_remove_ordered(rows, idx);
-		slice_remove_ordered(node_map, idx);
+		auto lost = degree(idx) + reverse_adjacency.count_in_row(idx);
+		if(adjacency.get(idx, idx)){ lost -= 1; }
+		edge_total -= lost;
+
+		if(!edge_weights.empty()){
+			adjacency.for_each_in_row(idx, [&](usize adj){
+				edge_weights.del(edge_key(node, node_map[adj]));
+			});
+			reverse_adjacency.for_each_in_row(idx, [&](usize adj){
+				edge_weights.del(edge_key(node_map[adj], node));
+			});
+		}
+
+		adjacency.clear_index(idx);
+		reverse_adjacency.clear_index(idx);
+		version += 1;
+		if(closure.enabled()){ closure.remove_node(*this, idx); }
+		alive_slots[idx] = false;
+		free_slots.append(idx);
+		node_index.del(node);
+
+		if((free_slots.size() * compact_ratio) > size()){
+			compact();
+		}
+	}
+
+	// Remove dead slots, renumbering live nodes while keeping their order.
+	// Both matrices are compacted into copies first, so running out of
+	// memory leaves the graph as it was.
+	void compact(){
+		if(free_slots.empty()){ return; }
+
+		auto keep = view<bool>(alive_slots.raw_data(), alive_slots.size());
+		auto new_adjacency = bit_matrix(storage_allocator);
+		auto err = adjacency.compact_into(new_adjacency, keep);
+		if(!x::error_ok(err)){ return; }
+		auto new_reverse = bit_matrix(storage_allocator);
+		err = reverse_adjacency.compact_into(new_reverse, keep);
+		if(!x::error_ok(err)){ return; }
+		if(closure.enabled()){
+			err = closure.compact(keep);
+			if(!x::error_ok(err)){ closure.reset(); }
+		}
 
-		for(usize node = 0; node < rows.size(); node += 1){
-			// auto& row = rows[node];
-			slice_remove_ordered(rows[node], idx);
+		version += 1;
+		adjacency = x::move(new_adjacency);
+		reverse_adjacency = x::move(new_reverse);
+
+		usize n = 0;
+		for(usize i = 0; i < node_map.size(); i += 1){
+			if(alive_slots[i]){
+				node_map[n] = node_map[i];
+				node_index.set(node_map[n], n);
+				n += 1;
+			}
 		}
 
+		while(node_map.size() > n){
+			node_map.pop();
+			alive_slots.pop();
+		}
+		for(auto& a : alive_slots){ a = true; }
+		free_slots.clear();
 	}
 
 	bool connected(graph_node a, graph_node b) const {
@@ -129,299 +1234,565 @@ struct connectivity_matrix {
 			return false;
 		}
 
-		return rows[idx_a][idx_b];
+		return adjacency.get(idx_a, idx_b);
 	}
 
 	void connect(graph_node a, graph_node b, bool bidirectional = false){
 		set_connection(a, b, true, bidirectional);
 	}
 
+	// Connect with a weight other than 1, used by shortest_distances()
+	void connect_weighted(graph_node a, graph_node b, u32 weight, bool bidirectional = false){
+		set_connection(a, b, true, bidirectional, weight);
+	}
+
+	// Weight of the edge a -> b, -1 if there is none
+	i64 weight(graph_node a, graph_node b) const {
+		if(!connected(a, b)){ return -1; }
+		auto [w, ok] = edge_weights.get(edge_key(a, b));
+		return ok ? i64(w) : 1;
+	}
+
 	void disconnect(graph_node a, graph_node b, bool bidirectional = false){
 		set_connection(a, b, false, bidirectional);
 	}
 
-	void set_connection(graph_node a, graph_node b, bool value, bool bidirectional){
+	void set_connection(graph_node a, graph_node b, bool value, bool bidirectional, u32 weight = 1){
 		auto idx_a = index_of(a);
 		auto idx_b = index_of(b);
 		if((idx_a < 0) || (idx_b < 0)){
 			return;
 		}
 
-		rows[idx_a][idx_b] = value;
+		// Removed edges forget their weight
+		if(!value){ weight = 1; }
+		set_edge(idx_a, idx_b, value);
+		set_weight(a, b, weight);
 		if(bidirectional){
-			rows[idx_b][idx_a] = value;
+			set_edge(idx_b, idx_a, value);
+			set_weight(b, a, weight);
+		}
+	}
+
+	// List of every (from, to) edge, in row order
+	[[nodiscard]]
+	slice<pair<graph_node, graph_node>> edges() const {
+		auto list = dynamic_array<pair<graph_node, graph_node>>(default_allocator);
+		for(usize i = 0; i < size(); i += 1){
+			for_each_neighbor(i, [&](usize adj){
+				list.append({label_index(i), label_index(adj)});
+			});
+		}
+		return list.extract_data();
+	}
+
+	slice<graph_node> depth_first_search(graph_node start_node) const {
+		return labeled_search(*this, start_node, false);
+	}
+
+	slice<graph_node> breadth_first_search(graph_node start_node) const {
+		return labeled_search(*this, start_node, true);
+	}
+
+	// Rows and columns follow the order of live_nodes()
+	[[nodiscard]]
+	slice<slice<i32>> reachability_matrix() const {
+		sync_cache();
+		auto [cached, hit] = reachability_cache.get(default_allocator);
+		if(hit){ return cached; }
+
+		auto res = live_submatrix(reachability_levels(*this));
+		reachability_cache.put(res);
+		return res;
+	}
+
+	// Rows and columns follow the order of live_nodes()
+	[[nodiscard]]
+	slice<slice<bool>> reachability_matrix_bool() const {
+		if(!closure.enabled()){
+			return live_submatrix(reachability_bool(*this));
+		}
+
+		auto bmat = make_slice<slice<bool>>(default_allocator, size());
+		for(usize i = 0; i < size(); i += 1){
+			bmat[i] = make_slice<bool>(default_allocator, size());
+			for(usize j = 0; j < size(); j += 1){
+				bmat[i][j] = (i != j) && closure.reachable(i, j);
+			}
+		}
+		return live_submatrix(bmat);
+	}
+
+	// Keep the transitive closure up to date from now on (see
+	// dynamic_closure), which makes reachable() a bit test. Costs V*V bits
+	// and some work on every change to the graph.
+	void track_reachability(bool enable = true){
+		if(enable == closure.enabled()){ return; }
+		if(enable){ closure.assign(reachability_bits(*this)); }
+		else { closure.reset(); }
+	}
+
+	// Whether b can be reached from a, every node reaches itself. O(1) while
+	// tracking reachability, otherwise answered by a reachability_index that
+	// is built in O(V+E) after every change.
+	bool reachable(graph_node a, graph_node b) const {
+		if(closure.enabled()){
+			auto idx_a = index_of(a);
+			auto idx_b = index_of(b);
+			return (idx_a >= 0) && (idx_b >= 0) && closure.reachable(idx_a, idx_b);
+		}
+		sync_cache();
+		return indexed_reachable(*this, reach_index, a, b);
+	}
+
+	[[nodiscard]]
+	slice<slice<graph_node>> strongly_connected_subgraphs() const {
+		sync_cache();
+		auto [cached, hit] = components_cache.get(default_allocator);
+		if(hit){ return cached; }
+
+		auto res = labeled_components(*this);
+		components_cache.put(res);
+		return res;
+	}
+
+	// Nodes ordered so that every edge points forward, empty if there is a
+	// cycle. O(V+E).
+	[[nodiscard]]
+	slice<graph_node> topological_order() const {
+		return labeled_topological_order(*this);
+	}
+
+	// Steps needed to reach each live node, in the order of live_nodes()
+	[[nodiscard]]
+	slice<pair<graph_node, i32>> transitive_closure(graph_node start_node) const {
+		if(index_of(start_node) < 0){ return {}; }
+
+		sync_cache();
+		auto [cached, hit] = closure_cache.get(start_node, default_allocator);
+		if(hit){ return cached; }
+
+		auto res = labeled_levels(*this, start_node);
+		closure_cache.put(start_node, res);
+		return res;
+	}
+
+	// Weighted distance to each live node, in the order of live_nodes(), -1
+	// for the ones that cannot be reached. Without weights these are the
+	// same numbers as transitive_closure() gives.
+	[[nodiscard]]
+	slice<pair<graph_node, i64>> shortest_distances(graph_node start_node) const {
+		return labeled_distances(*this, start_node);
+	}
+
+	// Path queries reuse the graph's workspace, so they must not run
+	// concurrently on the same graph.
+	[[nodiscard]]
+	slice<graph_node> find_path(graph_node start, graph_node target, path_mode mode = path_mode::DepthFirst) const {
+		return labeled_path(*this, start, target, mode);
+	}
+
+	explicit
+	connectivity_matrix(slice<graph_node> nodes)
+		: node_map(storage_allocator, nodes.size()),
+		alive_slots(storage_allocator, nodes.size()),
+		free_slots(storage_allocator),
+		node_index(storage_allocator, nodes.size() * 2),
+		adjacency(storage_allocator),
+		reverse_adjacency(storage_allocator),
+		edge_weights(storage_allocator),
+		closure(storage_allocator),
+		workspace(storage_allocator),
+		reach_index(storage_allocator),
+		closure_cache(storage_allocator, closure_cache_budget),
+		reachability_cache(storage_allocator),
+		components_cache(storage_allocator)
+	{
+		adjacency.reserve(nodes.size());
+		reverse_adjacency.reserve(nodes.size());
+		for(auto node : nodes){
+			add_node(node);
+		}
+	}
+
+	connectivity_matrix(connectivity_matrix const&) = delete;
+	void operator=(connectivity_matrix const&) = delete;
+
+	connectivity_matrix(connectivity_matrix&& m)
+		: node_map{x::move(m.node_map)},
+		alive_slots{x::move(m.alive_slots)},
+		free_slots{x::move(m.free_slots)},
+		node_index{x::move(m.node_index)},
+		adjacency{x::move(m.adjacency)},
+		reverse_adjacency{x::move(m.reverse_adjacency)},
+		edge_weights{x::move(m.edge_weights)},
+		closure{x::move(m.closure)},
+		edge_total{x::exchange(m.edge_total, 0)},
+		workspace{x::move(m.workspace)},
+		version{x::exchange(m.version, 0)},
+		cached_version{x::exchange(m.cached_version, 0)},
+		reach_index{x::move(m.reach_index)},
+		closure_cache{x::move(m.closure_cache)},
+		reachability_cache{x::move(m.reachability_cache)},
+		components_cache{x::move(m.components_cache)} {}
+
+	void operator=(connectivity_matrix&& m){
+		node_map    = x::move(m.node_map);
+		alive_slots = x::move(m.alive_slots);
+		free_slots  = x::move(m.free_slots);
+		node_index  = x::move(m.node_index);
+		adjacency   = x::move(m.adjacency);
+		reverse_adjacency = x::move(m.reverse_adjacency);
+		edge_weights = x::move(m.edge_weights);
+		closure = x::move(m.closure);
+		edge_total  = x::exchange(m.edge_total, 0);
+		workspace = x::move(m.workspace);
+		version = x::exchange(m.version, 0);
+		cached_version = x::exchange(m.cached_version, 0);
+		reach_index = x::move(m.reach_index);
+		closure_cache = x::move(m.closure_cache);
+		reachability_cache = x::move(m.reachability_cache);
+		components_cache = x::move(m.components_cache);
+	}
+
+	graph_node label_index(usize index) const {
+		return node_map[index];
+	}
+
+	// Make the draft of a graph shared with reader threads match this one
+	// and publish it. Node ids are kept.
+	u64 share(versioned_graph& shared) const {
+		shared.load(*this, [&](usize i){
+			return alive(i) ? node_map[i].id : versioned_graph::none;
+		});
+		return shared.publish();
+	}
+
+private:
+	// Drop the cached results if the graph changed since they were computed
+	void sync_cache() const {
+		if(cached_version == version){ return; }
+		reach_index.clear();
+		closure_cache.clear();
+		reachability_cache.clear();
+		components_cache.clear();
+		cached_version = version;
+	}
+
+	void set_edge(usize from, usize to, bool value){
+		if(adjacency.get(from, to) == value){ return; }
+		adjacency.set(from, to, value);
+		reverse_adjacency.set(to, from, value);
+		edge_total = value ? (edge_total + 1) : (edge_total - 1);
+		version += 1;
+
+		if(closure.enabled()){
+			if(value){ closure.insert_edge(from, to); }
+			else { closure.remove_edge(*this, from, to); }
+		}
+	}
+
+	static u64 edge_key(graph_node a, graph_node b){
+		return (u64(a.id) << 32) | u64(b.id);
+	}
+
+	// Only weights other than 1 are stored
+	void set_weight(graph_node a, graph_node b, u32 weight){
+		if(weight != 1){
+			auto [old, ok] = edge_weights.get(edge_key(a, b));
+			if(ok && (old == weight)){ return; }
+			edge_weights.set(edge_key(a, b), weight);
+			version += 1;
+		}
+		else if(!edge_weights.empty()){
+			if(edge_weights.del(edge_key(a, b))){ version += 1; }
+		}
+	}
+
+	template<typename T>
+	slice<slice<T>> live_submatrix(slice<slice<T>> mat) const {
+		if(free_slots.empty()){ return mat; }
+
+		auto live = make_slice<slice<T>>(default_allocator, node_count());
+		usize r = 0;
+		for(usize i = 0; i < size(); i += 1){
+			if(!alive(i)){ continue; }
+			live[r] = make_slice<T>(default_allocator, node_count());
+			usize c = 0;
+			for(usize j = 0; j < size(); j += 1){
+				if(!alive(j)){ continue; }
+				live[r][c] = mat[i][j];
+				c += 1;
+			}
+			r += 1;
 		}
+		return live;
 	}
+};
 
-	slice<graph_node> depth_first_search(graph_node start_node) {
-		auto visited = x::make_slice<bool>(default_allocator, rows.size());
-		auto start = index_of(start_node);
-		auto stack = x::stack<usize>(default_allocator);
-		auto trail = x::dynamic_array<usize>(default_allocator);
+// Immutable labeled graph on top of a csr_adjacency
+struct csr_graph {
+	slice<graph_node> node_map;
+	hash_map<graph_node, usize> node_index;
+	csr_adjacency adjacency{default_allocator};
+	// Scratch memory of the search queries, which therefore must not run
+	// concurrently on the same graph.
+	mutable traversal_workspace workspace{default_allocator};
+	// Built by the first reachable() query
+	mutable reachability_index reach_index{default_allocator};
+
+	usize size() const {
+		return node_map.size();
+	}
 
-		stack.push(start);
+	usize node_count() const {
+		return node_map.size();
+	}
 
-		while(!stack.empty()){
-			auto cur = stack.top();
-			stack.pop();
+	// Every node of a csr_graph is alive
+	bool alive(usize) const {
+		return true;
+	}
 
-			if(visited[cur]){ continue; }
+	usize edge_count() const {
+		return adjacency.edge_count();
+	}
 
-			visited[cur] = true;
-			trail.append(cur);
+	usize degree(usize node) const {
+		return adjacency.degree(node);
+	}
 
-			for(usize adj = 0; adj < rows.size(); adj += 1){
-				if(rows[cur][adj]){
-					stack.push(adj);
-				}
-			}
-		}
+	view<u32> neighbors_of(usize node) const {
+		return adjacency.neighbors_of(node);
+	}
 
-		auto data = label_indices(trail.extract_data());
-		for(usize i = 0; i < (data.size() / 2); i += 1){
-			x::swap(data[i], data[data.size() - (i+1)]);
-		}
-		return data;
+	template<typename Func>
+	void for_each_neighbor(usize node, Func&& fn) const {
+		adjacency.for_each_neighbor(node, x::forward<Func>(fn));
 	}
 
-	slice<graph_node> breadth_first_search(graph_node start_node) {
-		auto visited = x::make_slice<bool>(default_allocator, rows.size());
-		auto start = index_of(start_node);
-		auto queue = std::queue<usize>();
-		auto trail = x::dynamic_array<usize>(default_allocator);
+	template<typename Func>
+	void for_each_weighted_neighbor(usize node, Func&& fn) const {
+		adjacency.for_each_weighted_neighbor(node, x::forward<Func>(fn));
+	}
 
-		queue.push(start);
+	isize next_neighbor(usize node, usize& cursor) const {
+		return adjacency.next_neighbor(node, cursor);
+	}
 
-		while(!queue.empty()){
-			auto cur = queue.front();
-			queue.pop();
+	isize next_in_neighbor(usize node, usize& cursor) const {
+		return adjacency.next_in_neighbor(node, cursor);
+	}
 
-			if(visited[cur]){ continue; }
+	isize index_of(graph_node node) const {
+		auto [idx, ok] = node_index.get(node);
+		return ok ? isize(idx) : -1;
+	}
 
-			visited[cur] = true;
-			trail.append(cur);
+	bool connected(graph_node a, graph_node b) const {
+		auto idx_a = index_of(a);
+		auto idx_b = index_of(b);
 
-			for(usize adj = 0; adj < rows.size(); adj += 1){
-				if(rows[cur][adj]){
-					queue.push(adj);
-				}
-			}
+		if((idx_a < 0) || (idx_b < 0)){
+			return false;
 		}
 
-		auto data = label_indices(trail.extract_data());
-		for(usize i = 0; i < (data.size() / 2); i += 1){
-			x::swap(data[i], data[data.size() - (i+1)]);
-		}
-		return data;
+		return adjacency.has_edge(idx_a, idx_b);
 	}
 
-	[[nodiscard]]
-	slice<slice<i32>> reachability_matrix() const {
-		auto mat = x::make_slice<slice<i32>>(default_allocator, rows.size());
-		for(auto& row : mat){
-			row = x::make_slice<i32>(default_allocator, rows.size());
-		}
+	// Whether b can be reached from a, every node reaches itself. The first
+	// query builds a reachability_index, O(V+E), the others take about
+	// constant time.
+	bool reachable(graph_node a, graph_node b) const {
+		return indexed_reachable(*this, reach_index, a, b);
+	}
 
-		for(usize node = 0; node < rows.size(); node += 1){
-			auto clo = transitive_closure(label_index(node));
-			for(usize i = 0; i < rows.size(); i += 1){
-				mat[node][i] = clo[i].b;
-			}
-		}
+	slice<graph_node> depth_first_search(graph_node start_node) const {
+		return labeled_search(*this, start_node, false);
+	}
 
-		return mat;
+	slice<graph_node> breadth_first_search(graph_node start_node) const {
+		return labeled_search(*this, start_node, true);
 	}
 
 	[[nodiscard]]
-	slice<slice<bool>> reachability_matrix_bool() const {
-		auto mat = reachability_matrix();
-		auto bmat = make_slice<slice<bool>>(default_allocator, mat.size());
-		for(auto& b : bmat){
-			b = make_slice<bool>(default_allocator, mat.size());
-		}
-
-		for(usize i = 0; i < mat.size(); i += 1){
-			for(usize j = 0; j < mat.size(); j += 1){
-				bmat[i][j] = mat[i][j] > 0;
-			}
-		}
+	slice<slice<i32>> reachability_matrix() const {
+		return reachability_levels(*this);
+	}
 
-		return bmat;
+	[[nodiscard]]
+	slice<slice<bool>> reachability_matrix_bool() const {
+		return reachability_bool(*this);
 	}
 
 	[[nodiscard]]
 	slice<slice<graph_node>> strongly_connected_subgraphs() const {
-		auto visited = x::make_slice<bool>(default_allocator, rows.size());
-		auto reach_mat = reachability_matrix_bool();
-		auto subgraphs = dynamic_array<slice<graph_node>>(default_allocator);
-
-		// NOTE: This is only to ensure that the set intersection works properly
-		for(usize i = 0; i < reach_mat.size(); i += 1){
-			reach_mat[i][i] = true;
-		}
-
-		isize node = 0;
-		while(node != -1){
-			auto row_set = set<usize>(default_allocator);
-			auto col_set = set<usize>(default_allocator);
-
-			// Fetch rows
-			for(usize i = 0; i < rows.size(); i += 1){
-				if(reach_mat[node][i]){
-					row_set.add(i);
-				}
-			}
-			// Fetch cols
-			for(usize i = 0; i < rows.size(); i += 1){
-				if(reach_mat[i][node]){
-					col_set.add(i);
-				}
-			}
-
-			auto inter = row_set.intersect(col_set).extract_data();
-
-			for(auto e : inter){
-				visited[e] = true;
-			}
-
-			if(inter.size() > 0){
-				auto nodes = label_indices(inter);
-				subgraphs.append(nodes);
-			}
-
-			visited[node] = true;
-			node = next_unvisited(visited);
-		}
+		return labeled_components(*this);
+	}
 
-		return subgraphs.extract_data();
+	[[nodiscard]]
+	slice<graph_node> topological_order() const {
+		return labeled_topological_order(*this);
 	}
 
 	[[nodiscard]]
 	slice<pair<graph_node, i32>> transitive_closure(graph_node start_node) const {
-		auto visited = x::make_slice<bool>(default_allocator, rows.size());
-		auto levels = x::make_slice<i32>(default_allocator, rows.size());
-
-		for(auto& p : levels){ p = -1; }
-
-		auto queue = std::queue<usize>();
-		auto start = index_of(start_node);
+		return labeled_levels(*this, start_node);
+	}
 
-		queue.push(start);
-		levels[start] = 0;
+	[[nodiscard]]
+	slice<pair<graph_node, i64>> shortest_distances(graph_node start_node) const {
+		return labeled_distances(*this, start_node);
+	}
 
-		while(!queue.empty()){
-			auto cur = queue.front();
-			queue.pop();
+	// Path queries reuse the graph's workspace, so they must not run
+	// concurrently on the same graph.
+	[[nodiscard]]
+	slice<graph_node> find_path(graph_node start, graph_node target, path_mode mode = path_mode::DepthFirst) const {
+		return labeled_path(*this, start, target, mode);
+	}
 
-			if(visited[cur]){
-				continue;
-			}
+	// Build from a node list and (from, to) edges. Edges with unknown
+	// endpoints are ignored, duplicated edges are stored once.
+	csr_graph(slice<graph_node> nodes, slice<pair<graph_node, graph_node>> edges)
+		: node_index(default_allocator, nodes.size() * 2)
+	{
+		node_map = make_slice<graph_node>(default_allocator, nodes.size());
+		x::slice_copy(node_map, nodes);
+		index_nodes(node_index, node_map);
+
+		auto resolved = dynamic_array<pair<u32, u32>>(default_allocator, edges.size() + 1);
+		for(auto [a, b] : edges){
+			auto idx_a = index_of(a);
+			auto idx_b = index_of(b);
+			if((idx_a < 0) || (idx_b < 0)){ continue; }
+			resolved.append({u32(idx_a), u32(idx_b)});
+		}
 
-			visited[cur] = true;
-			for(usize adj = 0; adj < rows.size(); adj += 1){
-				if(rows[cur][adj] && !visited[adj]){
-					queue.push(adj);
-					levels[adj] = levels[cur] + 1;
+		// Two stable counting sorts, by destination then by source, leave
+		// every neighbour list sorted.
+		auto by_dest = bucket_edges(resolved.extract_data(), false);
+		auto by_src  = bucket_edges(by_dest, true);
+
+		auto offsets = make_slice<usize>(default_allocator, size() + 1);
+		auto unique = dynamic_array<u32>(default_allocator, by_src.size() + 1);
+		usize e = 0;
+		for(usize node = 0; node < size(); node += 1){
+			offsets[node] = unique.size();
+			isize last = -1;
+			while((e < by_src.size()) && (by_src[e].a == node)){
+				if(isize(by_src[e].b) != last){
+					last = by_src[e].b;
+					unique.append(by_src[e].b);
 				}
+				e += 1;
 			}
-
 		}
+		offsets[size()] = unique.size();
+		adjacency = csr_adjacency(default_allocator, offsets, unique.extract_data());
+	}
 
-		auto res = x::make_slice<pair<graph_node, i32>>(default_allocator, rows.size());
-		for(usize i = 0; i < rows.size(); i += 1){
-			res[i] = {label_index(i), levels[i]};
+	// Build from the live nodes of a connectivity_matrix
+	explicit
+	csr_graph(connectivity_matrix const& mat)
+		: node_index(default_allocator, mat.node_count() * 2)
+	{
+		node_map = mat.live_nodes();
+		index_nodes(node_index, node_map);
+
+		// Slots past dead ones shift down, order is preserved
+		auto dense = make_slice<u32>(default_allocator, mat.size());
+		for(usize i = 0, n = 0; i < mat.size(); i += 1){
+			dense[i] = u32(n);
+			n += mat.alive(i) ? 1 : 0;
 		}
 
-		return res;
+		auto offsets = make_slice<usize>(default_allocator, size() + 1);
+		auto adj = dynamic_array<u32>(default_allocator);
+		auto weights = dynamic_array<u32>(default_allocator);
+		auto weighted = !mat.edge_weights.empty();
+		for(usize slot = 0; slot < mat.size(); slot += 1){
+			if(!mat.alive(slot)){ continue; }
+			offsets[dense[slot]] = adj.size();
+			mat.for_each_weighted_neighbor(slot, [&](usize n, u32 w){
+				adj.append(dense[n]);
+				if(weighted){ weights.append(w); }
+			});
+		}
+		offsets[size()] = adj.size();
+		adjacency = csr_adjacency(default_allocator, offsets, adj.extract_data());
+		if(weighted){ adjacency.weights = weights.extract_data(); }
 	}
 
-	[[nodiscard]]
-	slice<graph_node> find_path(graph_node start, graph_node target) const {
-		auto visited = make_slice<bool>(default_allocator, rows.size());
-
-		x::mem_set(visited.raw_data(), 0, visited.size() * sizeof(bool));
-
-		auto start_idx = index_of(start);
-		auto target_idx = index_of(target);
-		if((start_idx < 0) || (target_idx < 0)){ return {}; }
-
-		auto path = path_search_rec(start_idx, target_idx, visited);
+	// Save adjacency and strongly connected components, and the labels of
+	// the nodes when a table is given, so the graph can be reopened with
+	// graph_snapshot::open(). The transitive closure takes V*V bits and is
+	// only included when asked for.
+	snapshot_error write_snapshot(char const* path, label_table const* labels = nullptr, bool with_closure = false) const {
+		auto [comp, comp_count] = tarjan_components(*this);
+		Defer(x::destroy(default_allocator, comp));
 
-		auto labeled = make_slice<graph_node>(default_allocator, path.size());
-		auto map = x::view(node_map);
+		auto closure = bit_matrix(default_allocator);
+		if(with_closure){ closure = reachability_bits(*this); }
+		auto closure_ptr = with_closure ? &closure : nullptr;
 
-		for(usize i = 0; i < labeled.size(); i += 1){
-			auto idx = path[path.size() - (i+1)];
-			labeled[i] = map[idx];
+		if(labels == nullptr){
+			return ::write_snapshot(path, adjacency, nullptr, comp, comp_count, closure_ptr);
 		}
-
-		return labeled;
+		auto label = [&](usize i){
+			auto name = labels->name(node_map[i].id);
+			return view<u8>(name.raw_data(), name.size());
+		};
+		return ::write_snapshot(path, adjacency, label, comp, comp_count, closure_ptr);
 	}
 
-	constexpr explicit
-	connectivity_matrix(slice<graph_node> nodes) {
-		using namespace x;
-		node_map = make_slice<graph_node>(default_allocator, nodes.size());
-		slice_copy(node_map, nodes);
-
-		rows = make_slice<row>(default_allocator, nodes.size());
-		for(auto& row : rows){
-			row = make_slice<bool>(default_allocator, nodes.size());
-			mem_set(row.raw_data(), 0, row.size() * sizeof(row[0]));
-		}
-	}
+	csr_graph(csr_graph const&) = delete;
+	void operator=(csr_graph const&) = delete;
 
-	~connectivity_matrix(){
-		for(usize i = 0; i < rows.size(); i += 1){
-			x::destroy(default_allocator, rows[i]);
-		}
+	csr_graph(csr_graph&& g)
+		: node_map{x::move(g.node_map)},
+		node_index{x::move(g.node_index)},
+		adjacency{x::move(g.adjacency)},
+		workspace{x::move(g.workspace)},
+		reach_index{x::move(g.reach_index)} {}
 
-		x::destroy(default_allocator, rows);
+	void operator=(csr_graph&& g){
 		x::destroy(default_allocator, node_map);
+		node_map   = x::move(g.node_map);
+		node_index = x::move(g.node_index);
+		adjacency  = x::move(g.adjacency);
+		workspace  = x::move(g.workspace);
+		reach_index = x::move(g.reach_index);
 	}
 
-	slice<graph_node> label_indices(slice<usize> indexes) const {
-		auto labeled = make_slice<graph_node>(default_allocator, indexes.size());
-
-		for(usize i = 0; i < labeled.size(); i += 1){
-			auto idx = indexes[indexes.size() - (i+1)];
-			labeled[i] = label_index(idx);
-		}
-
-		return labeled;
+	~csr_graph(){
+		x::destroy(default_allocator, node_map);
 	}
 
 	graph_node label_index(usize index) const {
-		auto labeled = graph_node();
-		auto map = x::view(node_map);
-
-		labeled = map[index];
-
-		return labeled;
+		return node_map[index];
 	}
 
 private:
-	dynamic_array<usize> path_search_rec(usize cur, usize target, slice<bool>& visited) const {
-		visited[cur] = true;
-
-		if(cur == target){
-			auto path = dynamic_array<usize>(default_allocator);
-			path.append(cur);
-			return path;
-		}
-
-		auto const& row = rows[cur];
-		for(usize neighbor = 0; neighbor < row.size(); neighbor += 1){
-			if(row[neighbor] && !visited[neighbor]){
-				auto path = path_search_rec(neighbor, target, visited);
-				if(!path.empty()){
-					path.append(cur);
-					return path;
-				}
-			}
+	slice<pair<u32, u32>> bucket_edges(view<pair<u32, u32>> list, bool by_source) const {
+		auto counts = make_slice<usize>(default_allocator, size() + 1);
+		auto key = [by_source](pair<u32, u32> e){ return by_source ? e.a : e.b; };
+
+		for(auto e : list){
+			counts[key(e) + 1] += 1;
+		}
+		for(usize i = 1; i < counts.size(); i += 1){
+			counts[i] += counts[i - 1];
+		}
+
+		auto sorted = make_slice<pair<u32, u32>>(default_allocator, list.size());
+		for(auto e : list){
+			auto& pos = counts[key(e)];
+			sorted[pos] = e;
+			pos += 1;
 		}
 
-		return dynamic_array<usize>(default_allocator); // No path
+		return sorted;
 	}
 };
 
@@ -436,6 +1807,7 @@ enum struct ui_operation : i32 	{
 	Search,
 	ClosuresAndReachability,
 	Subgraphs,
+	Viewport,
 
 	Error = -1,
 };
@@ -445,17 +1817,13 @@ bool whitespace(char c){
 	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
 }
 
-constexpr
-bool alphanum(char c){
-	return
-		((c >= 'a') && (c <= 'z')) || // Lowercase
-		((c >= 'A') && (c <= 'Z')) || // Uppercase
-		((c >= '0') && (c <= '9'));   // Numeric
-}
-
-constexpr
-bool valid_node_id(char c){
-	return alphanum(c) || (c == '_') || (c == '@') || (c == '$') || (c == '*');
+// Next whitespace separated word of line starting at pos, empty once there
+// are none left
+view<char> next_word(slice<char> line, usize& pos){
+	while((pos < line.size()) && whitespace(line[pos])){ pos += 1; }
+	auto begin = pos;
+	while((pos < line.size()) && !whitespace(line[pos])){ pos += 1; }
+	return view<char>(line.raw_data() + begin, pos - begin);
 }
 
 usize read_line(slice<char> buf, FILE* stream){
@@ -477,35 +1845,184 @@ struct user_input {
 };
 
 struct ui_context {
+	// Window of the matrix that gets printed, in live node positions. Bigger
+	// graphs are cut down to it, so a redraw costs the same at any size.
+	struct viewport {
+		usize row = 0;
+		usize col = 0;
+		usize rows = 48;
+		usize cols = 48;
+	};
+
+	label_table labels;
 	connectivity_matrix mat;
 	bool bidirectional;
+	viewport window;
+	// Rendered text, written to stdout in one go by flush_output()
+	x::string_builder out;
 
 	ui_context()
-		: mat(slice<graph_node>{}), bidirectional(false){}
+		: labels(storage_allocator), mat(slice<graph_node>{}), bidirectional(false), out(storage_allocator){}
+
+	string label(graph_node node) const {
+		return labels.name(node.id);
+	}
+
+	// Node called `word`. Unknown labels are interned when add is set,
+	// otherwise they become a node no graph holds.
+	graph_node node_named(view<char> word, bool add){
+		auto name = string(word);
+		return add ? labels.intern(name) : labels.find(name);
+	}
+
+	// Node of every word of line, in order
+	slice<graph_node> nodes_from_words(slice<char> line, bool add){
+		auto nodes = dynamic_array<graph_node>(default_allocator);
+		usize pos = 0;
+		while(1){
+			auto word = next_word(line, pos);
+			if(word.size() == 0){ break; }
+			nodes.append(node_named(word, add));
+		}
+		return nodes.extract_data();
+	}
+
+	// Replace the graph with a directed copy of g, node i of g gets the label
+	// name_of(i), which is interned
+	template<typename Graph, typename NameFunc>
+	void replace_graph(Graph const& g, NameFunc&& name_of){
+		auto nodes = make_slice<graph_node>(default_allocator, g.size());
+		for(usize i = 0; i < nodes.size(); i += 1){
+			nodes[i] = node_named(name_of(i), true);
+		}
+
+		bidirectional = false;
+		mat = connectivity_matrix(nodes);
+		for(usize i = 0; i < nodes.size(); i += 1){
+			g.for_each_neighbor(i, [&](usize j){
+				mat.connect(nodes[i], nodes[j]);
+			});
+		}
+	}
+
+	// Push a label, padded with spaces to width
+	void push_label(graph_node node, usize width = 0){
+		auto name = label(node);
+		out.push(name);
+		if(width > name.size()){ out.push_repeat(' ', width - name.size()); }
+	}
+
+	usize label_width(view<graph_node> nodes) const {
+		usize width = 1;
+		for(auto node : nodes){
+			width = x::max(width, label(node).size());
+		}
+		return width;
+	}
+
+	// Labels of the slots
+	slice<graph_node> slot_nodes(slice<usize> slots) const {
+		auto nodes = make_slice<graph_node>(default_allocator, slots.size());
+		for(usize i = 0; i < slots.size(); i += 1){
+			nodes[i] = mat.node_map[slots[i]];
+		}
+		return nodes;
+	}
+
+	void push_nodes(slice<graph_node> nodes){
+		for(auto node : nodes){
+			push_label(node);
+			out.push(byte(' '));
+		}
+	}
+
+	void flush_output(){
+		if(out.empty()){ return; }
+		std::fwrite(out.build().raw_data(), 1, out.size(), stdout);
+		out.clear();
+	}
+
+	// Slots of the live nodes inside of [first, first + count)
+	slice<usize> live_slots(usize first, usize count) const {
+		auto slots = dynamic_array<usize>(default_allocator, count + 1);
+		for(usize i = 0, pos = 0; (i < mat.size()) && (slots.size() < count); i += 1){
+			if(!mat.alive(i)){ continue; }
+			if(pos >= first){ slots.append(i); }
+			pos += 1;
+		}
+		return slots.extract_data();
+	}
+
+	bool window_cuts(usize n) const {
+		return (window.row > 0) || (window.col > 0) || (n > window.rows) || (n > window.cols);
+	}
+
+	// " _| c1 c2 ...", every column is as wide as its label and the row
+	// labels take row_width
+	void render_column_labels(view<graph_node> cols, usize row_width){
+		out.push_repeat(' ', row_width);
+		out.push("_| ");
+		for(auto c : cols){
+			push_label(c);
+			out.push(byte(' '));
+		}
+		out.push(byte('\n'));
+	}
+
+	void render_window_summary(usize n){
+		if(!window_cuts(n)){ return; }
+
+		auto row_end = x::min(window.row + window.rows, n);
+		auto col_end = x::min(window.col + window.cols, n);
+		auto cells = u64(n) * u64(n);
+		auto permille = (cells > 0) ? (u64(mat.edge_count()) * 1000) / cells : 0;
+
+		out.push("(Rows ");
+		out.push_integer(i64(x::min(window.row, n)));
+		out.push(byte('-'));
+		out.push_integer(i64(row_end));
+		out.push(", columns ");
+		out.push_integer(i64(x::min(window.col, n)));
+		out.push(byte('-'));
+		out.push_integer(i64(col_end));
+		out.push(" of ");
+		out.push_integer(i64(n));
+		out.push(" nodes, ");
+		out.push_integer(i64(mat.edge_count()));
+		out.push(" edges, ");
+		out.push_integer(i64(permille / 10));
+		out.push(byte('.'));
+		out.push_integer(i64(permille % 10));
+		out.push("% dense)\n");
+	}
 
 	void render_matrix(){
-		if(mat.rows.size() < 1){
-			std::printf("<Empty %s graph>\n\n", bidirectional ? "undirected" : "directed");
+		if(mat.node_count() < 1){
+			out.push(bidirectional ? "<Empty undirected graph>\n\n" : "<Empty directed graph>\n\n");
 			return;
 		}
 
-		std::printf("<%s graph>\n", bidirectional ? "Undirected" : "Directed");
-		std::printf(" _| ");
-		for(auto node : mat.node_map){
-			std::printf("%c ", node.label);
-		}
-		std::printf("\n");
+		out.push(bidirectional ? "<Undirected graph>\n" : "<Directed graph>\n");
 
-		for(usize i = 0; i < mat.rows.size(); i += 1){
-			auto row = mat.rows[i];
-			std::printf("%c | ", mat.node_map[i].label);
-			for(auto conn : row){
-				std::printf("%c ", conn ? '1' : ' ');
+		auto rows = live_slots(window.row, window.rows);
+		auto cols = live_slots(window.col, window.cols);
+		auto row_nodes = slot_nodes(rows);
+		auto col_nodes = slot_nodes(cols);
+		auto row_width = label_width(row_nodes);
+		render_column_labels(col_nodes, row_width);
+
+		for(usize i = 0; i < rows.size(); i += 1){
+			push_label(row_nodes[i], row_width);
+			out.push(" | ");
+			for(usize j = 0; j < cols.size(); j += 1){
+				out.push(byte(mat.adjacency.get(rows[i], cols[j]) ? '1' : ' '));
+				out.push_repeat(' ', label(col_nodes[j]).size());
 			}
-			std::printf("\n");
+			out.push(byte('\n'));
 		}
 
-		std::printf("\n");
+		render_window_summary(mat.node_count());
+		out.push(byte('\n'));
 	}
 
 	slice<char> render_menu(slice<char> line_buf){
@@ -518,12 +2035,14 @@ struct ui_context {
 			"[5] Search\n"
 			"[6] Reachability & Closures\n"
 			"[7] Strongly Connected Subgraphs\n"
+			"[8] Move Viewport\n"
 			"[x] Exit\n"
 		;
 
 		render_matrix();
-		std::puts(start_menu);
-		std::printf("> ");
+		out.push(start_menu);
+		out.push("\n> ");
+		flush_output();
 		auto n = read_line(line_buf.sub(0, line_buf.size() - 1), stdin);
 		line_buf[n] = 0;
 		return line_buf.sub(0, n);
@@ -559,18 +2078,7 @@ struct ui_context {
 		line_buf[n] = 0;
 		auto inp = line_buf.sub(0, n);
 
-		// mat = connectivity_matrix()
-
-		auto new_nodes = dynamic_array<graph_node>(default_allocator);
-
-		for(auto c : inp){
-			if(valid_node_id(c)){
-				// mat.add_node(c);
-				new_nodes.append(c);
-			}
-		}
-
-		mat = connectivity_matrix(new_nodes.extract_data());
+		mat = connectivity_matrix(nodes_from_words(inp, true));
 	}
 
 	void render_add_nodes_menu(slice<char> line_buf){
@@ -587,13 +2095,13 @@ struct ui_context {
 				return;
 			}
 
-			for(usize i = 0; i < inp.size(); i += 1){
-				auto c = inp[i];
-				if(valid_node_id(c)){
-					std::printf("+ %c\n", c);
-					mat.add_node(c);
-				}
+			for(auto node : nodes_from_words(inp, true)){
+				out.push("+ ");
+				push_label(node);
+				out.push(byte('\n'));
+				mat.add_node(node);
 			}
+			flush_output();
 		}
 	}
 
@@ -611,18 +2119,21 @@ struct ui_context {
 				return;
 			}
 
-			for(usize i = 0; i < inp.size(); i += 1){
-				auto c = inp[i];
-				if(valid_node_id(c)){
-					std::printf("- %c\n", c);
-					mat.del_node(c);
-				}
+			usize pos = 0;
+			while(1){
+				auto word = next_word(inp, pos);
+				if(word.size() == 0){ break; }
+				out.push("- ");
+				out.push(string(word));
+				out.push(byte('\n'));
+				mat.del_node(node_named(word, false));
 			}
+			flush_output();
 		}
 	}
 
 	void render_add_edges_menu(slice<char> line_buf){
-		std::printf("Add edges, e.g: a b <Enter> cb <Enter>\n");
+		std::printf("Add edges, e.g: a b <Enter> cb d <Enter>\n");
 		std::printf("Type 'done' when you're finished\n\n");
 
 		while(1){
@@ -635,24 +2146,19 @@ struct ui_context {
 				return;
 			}
 
-			pair<char, bool> label_a = {0, false};
-			pair<char, bool> label_b = {0, false};
-
-			for(usize i = 0; i < inp.size(); i += 1){
-				auto c = inp[i];
-				if(valid_node_id(c)){
-					if(!label_a.b){
-						label_a = {c, true};
-					}
-					else if(!label_b.b) {
-						label_b = {c, true};
-					}
-				}
-			}
-
-			if(label_a.b && label_b.b){
-				std::printf("%c %s %c\n", label_a.a,  bidirectional ? "<--->" : "--->", label_b.a);
-				mat.connect(label_a.a, label_b.a, bidirectional);
+			usize pos = 0;
+			auto word_a = next_word(inp, pos);
+			auto word_b = next_word(inp, pos);
+
+			if((word_a.size() > 0) && (word_b.size() > 0)){
+				auto a = node_named(word_a, false);
+				auto b = node_named(word_b, false);
+				out.push(string(word_a));
+				out.push(bidirectional ? " <---> " : " ---> ");
+				out.push(string(word_b));
+				out.push(byte('\n'));
+				flush_output();
+				mat.connect(a, b, bidirectional);
 			}
 			else {
 				std::printf("Invalid connection.\n");
@@ -661,7 +2167,7 @@ struct ui_context {
 	}
 
 	void render_del_edges_menu(slice<char> line_buf){
-		std::printf("Delete edges, e.g: a b <Enter> cb <Enter>\n");
+		std::printf("Delete edges, e.g: a b <Enter> cb d <Enter>\n");
 		std::printf("Type 'done' when you're finished\n\n");
 
 		while(1){
@@ -674,24 +2180,19 @@ struct ui_context {
 				return;
 			}
 
-			pair<char, bool> label_a = {0, false};
-			pair<char, bool> label_b = {0, false};
-
-			for(usize i = 0; i < inp.size(); i += 1){
-				auto c = inp[i];
-				if(valid_node_id(c)){
-					if(!label_a.b){
-						label_a = {c, true};
-					}
-					else if(!label_b.b) {
-						label_b = {c, true};
-					}
-				}
-			}
-
-			if(label_a.b && label_b.b){
-				std::printf("%c %s %c\n", label_a.a,  bidirectional ? "<-/->" : "-/->", label_b.a);
-				mat.disconnect(label_a.a, label_b.a, bidirectional);
+			usize pos = 0;
+			auto word_a = next_word(inp, pos);
+			auto word_b = next_word(inp, pos);
+
+			if((word_a.size() > 0) && (word_b.size() > 0)){
+				auto a = node_named(word_a, false);
+				auto b = node_named(word_b, false);
+				out.push(string(word_a));
+				out.push(bidirectional ? " <-/-> " : " -/-> ");
+				out.push(string(word_b));
+				out.push(byte('\n'));
+				flush_output();
+				mat.disconnect(a, b, bidirectional);
 			}
 			else {
 				std::printf("Invalid connection.\n");
@@ -702,35 +2203,31 @@ struct ui_context {
 	void render_strongly_connected_subgraphs(){
 		auto subgraphs = mat.strongly_connected_subgraphs();
 
-		if((subgraphs.size() == 1) && (subgraphs[0].size() == mat.rows.size())){
-			std::printf("Graph is fully connected.\n  ");
-			auto graph = subgraphs[0];
-			for(auto node : graph){
-				std::printf("%c ", node.label);
-			}
-			std::printf("\n");
+		if((subgraphs.size() == 1) && (subgraphs[0].size() == mat.node_count())){
+			out.push("Graph is fully connected.\n  ");
+			push_nodes(subgraphs[0]);
+			out.push(byte('\n'));
 		}
 		else {
-			std::printf("Strongly connected subgraphs:\n");
+			out.push("Strongly connected subgraphs:\n");
 			for(usize i = 0; i < subgraphs.size(); i += 1){
-				std::printf("  Subgraph %zu: ", i);
-				auto graph = subgraphs[i];
-				for(auto node : graph){
-					std::printf("%c ", node.label);
-				}
-				std::printf("\n");
+				out.push("  Subgraph ");
+				out.push_integer(i64(i));
+				out.push(": ");
+				push_nodes(subgraphs[i]);
+				out.push(byte('\n'));
 			}
 		}
 
-		std::printf("\n");
+		out.push(byte('\n'));
+		flush_output();
 	}
 
 	void render_graph_search_menu(slice<char> line_buf){
-		std::printf("Starting Node [ ");
-		for(auto c : mat.node_map){
-			std::printf("%c ", c.label);
-		}
-		std::printf("]\n");
+		out.push("Starting Node [ ");
+		push_nodes(mat.live_nodes());
+		out.push("]\n");
+		flush_output();
 
 		graph_node node;
 		while(1){
@@ -739,85 +2236,114 @@ struct ui_context {
 			line_buf[n] = 0;
 			auto inp = line_buf.sub(0, n);
 
-			if(inp.size() > 0){
-				node = inp[0];
+			usize pos = 0;
+			auto word = next_word(inp, pos);
+			if(word.size() > 0){
+				node = node_named(word, false);
 				break;
 			}
 		}
 
-		auto bfs = mat.breadth_first_search(node);
-		auto dfs = mat.depth_first_search(node);
+		out.push("BFS: ");
+		push_nodes(mat.breadth_first_search(node));
+		out.push("\nDFS: ");
+		push_nodes(mat.depth_first_search(node));
+		out.push(byte('\n'));
+		flush_output();
+	}
 
-		std::printf("BFS: ");
-		for(auto n : bfs){
-			std::printf("%c ", n.label);
+	void render_closures_and_rechability_matrix(){
+		// Every closure is a row of the reachability matrix, so search once
+		// from each node of the viewport's rows and print both from that.
+		// Only the rows and columns inside of the viewport are printed.
+		auto nodes = mat.live_nodes();
+		auto n = nodes.size();
+		auto row_end = x::min(window.row + window.rows, n);
+		auto col_end = x::min(window.col + window.cols, n);
+
+		auto reach_mat = make_slice<slice<pair<graph_node, i32>>>(default_allocator, n);
+		for(usize i = window.row; i < row_end; i += 1){
+			reach_mat[i] = mat.transitive_closure(nodes[i]);
 		}
-		std::printf("\n");
 
-		std::printf("DFS: ");
-		for(auto n : dfs){
-			std::printf("%c ", n.label);
-		}
-		std::printf("\n");
-	}
+		auto row_width = (window.row < row_end) ? label_width(view(nodes).sub(window.row, row_end)) : 1;
 
-	void render_closures_and_rechability_matrix(){
-		auto closures = dynamic_array<slice<pair<graph_node, i32>>>(default_allocator);
-		std::printf("Transitive closures:\n");
-		for(auto node : mat.node_map){
-			auto clo = mat.transitive_closure(node);
-			closures.append(clo);
-			std::printf("%c | ", node.label);
-			for(auto [reachable, steps] : clo){
+		out.push("Transitive closures:\n");
+		for(usize i = window.row; i < row_end; i += 1){
+			push_label(nodes[i], row_width);
+			out.push(" | ");
+			for(usize j = window.col; j < col_end; j += 1){
+				auto steps = reach_mat[i][j].b;
 				if(steps > -1){
-					std::printf("%c:%d ", reachable.label, steps);
+					push_label(nodes[j]);
+					out.push(byte(':'));
+					out.push_integer(steps);
+					out.push(byte(' '));
 				}
 			}
-			std::printf("\n");
-		}
-		std::printf("\n");
-
-		std::printf("Reachability matrix:\n");
-		std::printf(" _| ");
-		for(auto node : mat.node_map){
-			std::printf("%c ", node.label);
+			out.push(byte('\n'));
 		}
-		std::printf("\n");
-
-		auto reach_mat = mat.reachability_matrix();
-		for(usize i = 0; i < reach_mat.size(); i += 1){
-			auto const& row = reach_mat[i];
-			std::printf("%c | ", mat.node_map[i].label);
-			for(auto n : row){
-				if(n < 0){
-					std::printf("* ");
+		out.push(byte('\n'));
+
+		out.push("Reachability matrix:\n");
+		auto col_nodes = (window.col < col_end) ? view(nodes).sub(window.col, col_end) : view<graph_node>();
+		render_column_labels(col_nodes, row_width);
+
+		for(usize i = window.row; i < row_end; i += 1){
+			push_label(nodes[i], row_width);
+			out.push(" | ");
+			for(usize j = window.col; j < col_end; j += 1){
+				auto steps = reach_mat[i][j].b;
+				auto before = out.size();
+				if(steps < 0){
+					out.push(byte('*'));
 				}
 				else {
-					std::printf("%d ", n);
+					out.push_integer(steps);
 				}
+				// Pad to the column's label
+				auto width = label(nodes[j]).size();
+				auto used = out.size() - before;
+				out.push_repeat(' ', (width > used) ? (width - used + 1) : 1);
 			}
-			std::printf("\n");
+			out.push(byte('\n'));
 		}
 
-		std::printf("\n");
+		render_window_summary(n);
+		out.push(byte('\n'));
+		flush_output();
 	}
 
-};
+	void render_viewport_menu(slice<char> line_buf){
+		std::printf("First row and column, e.g: 0 48 (showing %zu x %zu)\n", window.rows, window.cols);
+		std::printf("(Viewport) > ");
+		auto n = read_line(line_buf.sub(0, line_buf.size() - 1), stdin);
+		line_buf[n] = 0;
 
-slice<graph_node> nodes_from_string(slice<char> str){
-	auto nodes = set<graph_node>(default_allocator);
-	for(auto c : str){
-		if(whitespace(c)){ continue; }
+		usize values[2] = {0, 0};
+		usize count = 0;
+		bool in_number = false;
+		for(auto c : line_buf.sub(0, n)){
+			if((c >= '0') && (c <= '9')){
+				if(!in_number){ count += 1; }
+				in_number = true;
+				if(count <= 2){ values[count - 1] = values[count - 1] * 10 + usize(c - '0'); }
+			}
+			else {
+				in_number = false;
+			}
+		}
 
-		if(valid_node_id(c)){
-			nodes.add(graph_node(c));
+		if(count == 2){
+			window.row = values[0];
+			window.col = values[1];
 		}
 		else {
-			printf("Invalid node label: %c\n", c);
+			std::printf("Invalid viewport.\n");
 		}
 	}
-	return nodes.extract_data();
-}
+
+};
 
 ui_operation input_to_ui_op(slice<char> input){
 	using O = ui_operation;
@@ -835,13 +2361,361 @@ ui_operation input_to_ui_op(slice<char> input){
 		case '5': return O::Search; break;
 		case '6': return O::ClosuresAndReachability; break;
 		case '7': return O::Subgraphs; break;
+		case '8': return O::Viewport; break;
 		case 'x': return O::Quit; break;
 	}
 
 	return O::Error;
 }
 
-int main() {
+// Non interactive mode, enabled with --batch. Commands are read one per line
+// from a script file or stdin, results are written to a fully buffered stdout
+// and the matrix is never redrawn unless asked for. Errors go to stderr and
+// do not stop the script.
+//
+//   new [directed|undirected] <labels>   Replace the graph
+//   load <file>                          Replace the graph with a directed one
+//                                        read from an edge list (see
+//                                        edge_list.hpp), labeled by node id.
+//                                        At most max_loaded_nodes nodes
+//   save <file>                          Write the graph and its labels as a
+//                                        snapshot (see snapshot.hpp), without
+//                                        weights
+//   open <file>                          Replace the graph with a directed one
+//                                        read from a snapshot. The snapshot is
+//                                        mapped in O(1) but copied into the
+//                                        matrix the other commands work on,
+//                                        which takes O(V*V). At most
+//                                        max_loaded_nodes nodes
+//   add <labels>                         Add nodes
+//   del <labels>                         Delete nodes
+//   connect <a> <b> [<c> <d> ...]        Add edges a->b, c->d, ...
+//   disconnect <a> <b> [<c> <d> ...]     Delete edges
+//   wconnect <a> <b> <w> [...]           Add edges a->b weighing w, ...
+//   bfs <a>, dfs <a>                     Visiting order from a, last node
+//                                        reached first
+//   path <a> <b> [dfs|bfs|bidirectional] Path from a to b, empty if none
+//   closure [<a>]                        Closure of a, of every node if omitted
+//   distances <a>                        Weighted distance from a to each node
+//   reachable <a> <b>                    "yes" if b can be reached from a
+//   track [on|off]                       Keep the transitive closure up to
+//                                        date, which makes reachable O(1) but
+//                                        costs V*V bits (see
+//                                        connectivity_matrix::track_reachability)
+//   scc                                  One strongly connected subgraph per line
+//   topo                                 Nodes in topological order, "cycle"
+//                                        if there is none
+//   show [<row> <col>]                   Print the matrix, from row and column
+//                                        on if given (see ui_context::viewport)
+//
+// Labels are any whitespace separated words. Empty lines and lines starting
+// with '#' are skipped.
+struct batch_context {
+	// Most nodes load and open accept. Every command works on the
+	// connectivity_matrix, which takes two V*V bit matrices, 256 MiB at
+	// this size, so larger graphs are refused instead of copied into it.
+	static constexpr usize max_loaded_nodes = usize(1) << 15;
+
+	ui_context ui;
+	usize line_number = 0;
+	usize error_count = 0;
+
+	// Run every command of a stream, returns the number of failed ones
+	usize run(FILE* script){
+		auto line_buf = make_slice<char>(storage_allocator, 4 * x::prefix::kibi);
+		Defer(x::destroy(storage_allocator, line_buf));
+
+		while(1){
+			auto length = read_batch_line(script, line_buf);
+			if(length < 0){ break; }
+			line_number += 1;
+			auto n = usize(length);
+			while((n > 0) && whitespace(line_buf[n - 1])){ n -= 1; }
+			auto line = line_buf.sub(0, n);
+			if(has_null(line)){ fail("malformed command, null byte in line"); }
+			else { run_line(line); }
+
+			// Results only live until the next command
+			arena.reset();
+		}
+
+		std::fflush(stdout);
+		return error_count;
+	}
+
+	void run_line(slice<char> line){
+		usize pos = 0;
+		auto cmd = string(next_word(line, pos));
+		auto args = line.sub(pos, line.size());
+
+		if(cmd.size() == 0 || cmd.raw_data()[0] == '#'){ return; }
+
+		// Only commands that create nodes intern new labels
+		if(cmd == "new"){
+			auto save = pos;
+			auto mode = string(next_word(line, pos));
+			if(mode == "directed"){ ui.bidirectional = false; }
+			else if(mode == "undirected"){ ui.bidirectional = true; }
+			else { pos = save; }
+			ui.mat = connectivity_matrix(ui.nodes_from_words(line.sub(pos, line.size()), true));
+		}
+		else if(cmd == "load" || cmd == "save" || cmd == "open"){
+			auto file = next_word(line, pos);
+			if(file.size() == 0){ return fail("expected a file"); }
+			if(next_word(line, pos).size() > 0){ return fail("too many arguments"); }
+			auto path = file_path(file);
+
+			if(cmd == "load"){
+				auto adj = csr_adjacency(storage_allocator);
+				auto err = load_edge_list(adj, path, storage_allocator, 0, max_loaded_nodes);
+				if(err == edge_list_error::OpenFailed){ return fail("could not open file"); }
+				if(err == edge_list_error::TooManyNodes){ return fail("too many nodes for the matrix"); }
+				if(!x::error_ok(err)){ return fail("bad edge list"); }
+				ui.replace_graph(adj, [&](usize i){ return number_text(i); });
+			}
+			else if(cmd == "save"){
+				auto err = csr_graph(ui.mat).write_snapshot(path, &ui.labels);
+				if(!x::error_ok(err)){ return fail("could not write snapshot"); }
+			}
+			else {
+				auto snap = graph_snapshot();
+				auto err = snap.open(path);
+				if(err == snapshot_error::OpenFailed){ return fail("could not open file"); }
+				if(!x::error_ok(err)){ return fail("bad snapshot"); }
+				if(snap.size() > max_loaded_nodes){ return fail("too many nodes for the matrix"); }
+				ui.replace_graph(snap, [&](usize i){
+					if(!snap.has_labels()){ return number_text(i); }
+					auto name = snap.label(i);
+					return view<char>(reinterpret_cast<char const*>(name.raw_data()), name.size());
+				});
+			}
+		}
+		else if(cmd == "add"){
+			for(auto node : ui.nodes_from_words(args, true)){ ui.mat.add_node(node); }
+		}
+		else if(cmd == "del"){
+			for(auto node : ui.nodes_from_words(args, false)){ ui.mat.del_node(node); }
+		}
+		else if(cmd == "connect" || cmd == "disconnect"){
+			auto nodes = ui.nodes_from_words(args, false);
+			if(nodes.size() == 0 || nodes.size() % 2 != 0){
+				return fail("expected pairs of nodes");
+			}
+			for(usize i = 0; i < nodes.size(); i += 2){
+				if(cmd == "connect"){ ui.mat.connect(nodes[i], nodes[i + 1], ui.bidirectional); }
+				else { ui.mat.disconnect(nodes[i], nodes[i + 1], ui.bidirectional); }
+			}
+		}
+		else if(cmd == "wconnect"){
+			usize at = 0;
+			auto a = next_word(args, at);
+			if(a.size() == 0){ return fail("expected node, node, weight triples"); }
+			while(a.size() > 0){
+				auto b = next_word(args, at);
+				auto [w, ok] = number_of(next_word(args, at));
+				if((b.size() == 0) || !ok || (w > u64(~u32(0)))){
+					return fail("expected node, node, weight triples");
+				}
+				ui.mat.connect_weighted(ui.node_named(a, false), ui.node_named(b, false), u32(w), ui.bidirectional);
+				a = next_word(args, at);
+			}
+		}
+		else if(cmd == "bfs" || cmd == "dfs"){
+			auto nodes = ui.nodes_from_words(args, false);
+			if(nodes.size() != 1){ return fail("expected one node"); }
+			auto trail = (cmd == "bfs") ? ui.mat.breadth_first_search(nodes[0]) : ui.mat.depth_first_search(nodes[0]);
+			print_nodes(trail);
+		}
+		else if(cmd == "path"){
+			auto a = next_word(line, pos);
+			auto b = next_word(line, pos);
+			auto m = string(next_word(line, pos));
+			if((a.size() == 0) || (b.size() == 0)){ return fail("expected two nodes"); }
+			if(next_word(line, pos).size() > 0){ return fail("too many arguments"); }
+
+			auto mode = path_mode::DepthFirst;
+			if(m == "bfs"){ mode = path_mode::BreadthFirst; }
+			else if(m == "bidirectional"){ mode = path_mode::Bidirectional; }
+			else if((m.size() > 0) && (m != "dfs")){ return fail("bad path mode"); }
+
+			print_nodes(ui.mat.find_path(ui.node_named(a, false), ui.node_named(b, false), mode));
+		}
+		else if(cmd == "closure"){
+			auto nodes = ui.nodes_from_words(args, false);
+			if(nodes.size() > 1){ return fail("expected at most one node"); }
+			if(nodes.size() == 1){
+				print_closure(ui.mat.transitive_closure(nodes[0]));
+			}
+			else {
+				auto live = ui.mat.live_nodes();
+				auto reach_mat = ui.mat.reachability_matrix();
+				for(usize i = 0; i < reach_mat.size(); i += 1){
+					ui.push_label(live[i]);
+					ui.out.push(" |");
+					for(usize j = 0; j < reach_mat[i].size(); j += 1){
+						if(reach_mat[i][j] < 0){ continue; }
+						ui.out.push(byte(' '));
+						ui.push_label(live[j]);
+						ui.out.push(byte(':'));
+						ui.out.push_integer(reach_mat[i][j]);
+					}
+					ui.out.push(byte('\n'));
+				}
+			}
+		}
+		else if(cmd == "distances"){
+			auto nodes = ui.nodes_from_words(args, false);
+			if(nodes.size() != 1){ return fail("expected one node"); }
+			print_closure(ui.mat.shortest_distances(nodes[0]));
+		}
+		else if(cmd == "reachable"){
+			auto nodes = ui.nodes_from_words(args, false);
+			if(nodes.size() != 2){ return fail("expected two nodes"); }
+			ui.out.push(ui.mat.reachable(nodes[0], nodes[1]) ? "yes\n" : "no\n");
+		}
+		else if(cmd == "track"){
+			auto mode = string(next_word(line, pos));
+			if(next_word(line, pos).size() > 0){ return fail("too many arguments"); }
+			if((mode.size() == 0) || (mode == "on")){ ui.mat.track_reachability(true); }
+			else if(mode == "off"){ ui.mat.track_reachability(false); }
+			else { return fail("expected on or off"); }
+		}
+		else if(cmd == "scc"){
+			for(auto sub : ui.mat.strongly_connected_subgraphs()){
+				print_nodes(sub);
+			}
+		}
+		else if(cmd == "topo"){
+			auto order = ui.mat.topological_order();
+			if((order.size() == 0) && (ui.mat.node_count() > 0)){ ui.out.push("cycle\n"); }
+			else { print_nodes(order); }
+		}
+		else if(cmd == "show"){
+			auto row_word = next_word(line, pos);
+			auto col_word = next_word(line, pos);
+			if((row_word.size() > 0) || (col_word.size() > 0)){
+				auto [row, row_ok] = number_of(row_word);
+				auto [col, col_ok] = number_of(col_word);
+				if(!row_ok || !col_ok){ return fail("expected a row and a column"); }
+				ui.window.row = usize(row);
+				ui.window.col = usize(col);
+			}
+			ui.render_matrix();
+		}
+		else {
+			fail("unknown command");
+		}
+		ui.flush_output();
+	}
+
+private:
+	// Read a whole line into buf, doubling it until the line fits. Returns its
+	// length without the line break, -1 once the stream has no more lines.
+	// Null bytes are read like any other, so they cannot cut a line short.
+	static isize read_batch_line(FILE* script, slice<char>& buf){
+		usize n = 0;
+		int c = 0;
+		while(((c = std::getc(script)) != EOF) && (c != '\n')){
+			if(n == buf.size()){
+				auto bigger = make_slice<char>(storage_allocator, buf.size() * 2);
+				x::mem_copy(bigger.raw_data(), buf.raw_data(), n);
+				x::destroy(storage_allocator, buf);
+				buf = bigger;
+			}
+			buf[n] = char(c);
+			n += 1;
+		}
+		if((c == EOF) && (n == 0)){ return -1; }
+		return isize(n);
+	}
+
+	static bool has_null(slice<char> line){
+		for(auto c : line){
+			if(c == 0){ return true; }
+		}
+		return false;
+	}
+
+	// Value of a word of decimal digits, false if it is empty, has anything
+	// else in it or does not fit in a u64
+	static pair<u64, bool> number_of(view<char> word){
+		if(word.size() == 0){ return {0, false}; }
+		u64 n = 0;
+		for(auto c : word){
+			if((c < '0') || (c > '9')){ return {0, false}; }
+			auto d = u64(c - '0');
+			if(n > (~u64(0) - d) / 10){ return {0, false}; }
+			n = n * 10 + d;
+		}
+		return {n, true};
+	}
+
+	// Null terminated copy of a word
+	static char const* file_path(view<char> word){
+		auto path = make_slice<char>(default_allocator, word.size() + 1);
+		for(usize i = 0; i < word.size(); i += 1){
+			path[i] = word[i];
+		}
+		return path.raw_data();
+	}
+
+	// Decimal text of i, valid until the next call
+	view<char> number_text(usize i){
+		auto len = std::snprintf(number_buf, sizeof(number_buf), "%zu", i);
+		return view<char>(number_buf, usize(len));
+	}
+
+	void print_nodes(slice<graph_node> nodes){
+		for(usize i = 0; i < nodes.size(); i += 1){
+			if(i > 0){ ui.out.push(byte(' ')); }
+			ui.push_label(nodes[i]);
+		}
+		ui.out.push(byte('\n'));
+	}
+
+	// Reached nodes with their distance, unreachable ones are skipped
+	template<typename Dist>
+	void print_closure(slice<pair<graph_node, Dist>> closure){
+		bool first = true;
+		for(auto [node, steps] : closure){
+			if(steps < 0){ continue; }
+			if(!first){ ui.out.push(byte(' ')); }
+			ui.push_label(node);
+			ui.out.push(byte(':'));
+			ui.out.push_integer(steps);
+			first = false;
+		}
+		ui.out.push(byte('\n'));
+	}
+
+	void fail(char const* msg){
+		error_count += 1;
+		std::fprintf(stderr, "line %zu: %s\n", line_number, msg);
+	}
+
+	char number_buf[24];
+};
+
+// Left out by the tests, which include this file
+#ifndef GRAPH_NO_MAIN
+int main(int argc, char** argv) {
+	if((argc > 1) && (string(argv[1]) == "--batch")){
+		auto script = stdin;
+		if(argc > 2){
+			script = std::fopen(argv[2], "r");
+			if(script == nullptr){
+				std::fprintf(stderr, "Could not open %s\n", argv[2]);
+				return 1;
+			}
+		}
+
+		std::setvbuf(stdout, nullptr, _IOFBF, 64 * x::prefix::kibi);
+		auto batch = batch_context();
+		auto failed = batch.run(script);
+		if(script != stdin){ std::fclose(script); }
+		return (failed > 0) ? 1 : 0;
+	}
+
 	auto line_buffer = make_slice<char>(default_allocator, 4 * x::prefix::kibi);
 	line_buffer = line_buffer.sub(0, line_buffer.size() - 1);
 
@@ -891,6 +2765,10 @@ int main() {
 				ui.render_strongly_connected_subgraphs();
 			} break;
 
+			case O::Viewport: {
+				ui.render_viewport_menu(line_buffer);
+			} break;
+
 			case O::Error: {
 				std::printf("\n<Unrcognized command: %s>\n", menu_input.raw_data());
 			} break;
@@ -900,3 +2778,4 @@ int main() {
 		x::mem_set(line_buffer.raw_data(), 0, line_buffer.size());
 	}
 }
+#endif
@@ -0,0 +1,106 @@
+#ifndef _label_table_hpp_include_
+#define _label_table_hpp_include_
+
+#include "core.hpp"
+
+// Interned node labels. Every distinct label gets a dense u32 id, in the order
+// they are first seen, so graphs only ever store and compare ids. The bytes are
+// copied into large chunks owned by the table, a label costs its length plus
+// one hash map slot, and names stay valid until the table is destroyed.
+struct label_table {
+	static constexpr x::u32 none = ~x::u32(0);
+	static constexpr x::usize chunk_size = 64 * x::prefix::kibi;
+
+	x::usize size() const {
+		return names.size();
+	}
+
+	// Id of name, which is added if it was not known. Returns none when the
+	// table is out of memory.
+	x::u32 intern(x::string name){
+		auto [id, ok] = ids.get(name);
+		if(ok){ return id; }
+
+		if(names.size() >= none){ return none; }
+		auto stored = store(name);
+		if(stored.size() != name.size()){ return none; }
+
+		id = x::u32(names.size());
+		if(!ids.set(stored, id)){ return none; }
+		names.append(stored);
+		return id;
+	}
+
+	// Id of name, none if it was never interned
+	x::u32 find(x::string name) const {
+		auto [id, ok] = ids.get(name);
+		return ok ? id : none;
+	}
+
+	x::string name(x::u32 id) const {
+		return names[id];
+	}
+
+	explicit
+	label_table(x::allocator al)
+		: backing_allocator{al}, chunks(al), names(al), ids(al) {}
+
+	label_table(label_table const&) = delete;
+	void operator=(label_table const&) = delete;
+
+	label_table(label_table&& t)
+		: backing_allocator{t.backing_allocator},
+		chunks{x::move(t.chunks)},
+		chunk_used{x::exchange(t.chunk_used, 0)},
+		names{x::move(t.names)},
+		ids{x::move(t.ids)} {}
+
+	void operator=(label_table&& t){
+		release();
+		backing_allocator = t.backing_allocator;
+		chunks     = x::move(t.chunks);
+		chunk_used = x::exchange(t.chunk_used, 0);
+		names      = x::move(t.names);
+		ids        = x::move(t.ids);
+	}
+
+	~label_table(){
+		release();
+	}
+
+private:
+	// Copy name into the last chunk, starting a new one when it does not
+	// fit. Labels longer than a chunk get one of their own.
+	x::string store(x::string name){
+		auto n = name.size();
+		if(n == 0){ return x::string(); }
+
+		if(chunks.empty() || (chunk_used + n > chunks[chunks.size() - 1].size())){
+			auto [chunk, err] = x::make_slice_checked<x::byte>(backing_allocator, x::max(n, chunk_size));
+			if(!x::error_ok(err)){ return x::string(); }
+			chunks.append(chunk);
+			chunk_used = 0;
+		}
+
+		auto dest = chunks[chunks.size() - 1].raw_data() + chunk_used;
+		x::mem_copy(dest, name.raw_data(), n);
+		chunk_used += n;
+		return x::string(x::view<x::byte>(dest, n));
+	}
+
+	void release(){
+		for(auto chunk : chunks){
+			x::destroy(backing_allocator, chunk);
+		}
+		chunks.clear();
+		chunk_used = 0;
+	}
+
+	x::allocator backing_allocator;
+	x::dynamic_array<x::slice<x::byte>> chunks;
+	x::usize chunk_used = 0;
+	x::dynamic_array<x::string> names;
+	x::hash_map<x::string, x::u32> ids;
+};
+
+#endif /* Include guard */
@@ -0,0 +1,131 @@
+#ifndef _mapped_file_hpp_include_
+#define _mapped_file_hpp_include_
+
+#include "core.hpp"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// Read only mapping of a whole file. Pages are only read in by the OS when
+// they are first touched, so opening takes the same time whatever the size.
+struct mapped_file {
+	enum struct error : x::i32 {
+		None = 0,
+		OpenFailed,
+		MapFailed,
+	};
+
+	x::view<x::u8> bytes() const {
+		return x::view<x::u8>(base, length);
+	}
+
+	x::usize size() const {
+		return length;
+	}
+
+	error open(char const* path){
+		close();
+
+		#if defined(_WIN32)
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(file == INVALID_HANDLE_VALUE){ return error::OpenFailed; }
+
+		LARGE_INTEGER file_size;
+		if(!GetFileSizeEx(file, &file_size)){
+			close();
+			return error::OpenFailed;
+		}
+		length = x::usize(file_size.QuadPart);
+		if(length == 0){ return error::None; }
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mapping == nullptr){
+			close();
+			return error::MapFailed;
+		}
+		base = static_cast<x::u8 const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if(base == nullptr){
+			close();
+			return error::MapFailed;
+		}
+		#else
+		auto fd = ::open(path, O_RDONLY);
+		if(fd < 0){ return error::OpenFailed; }
+		Defer(::close(fd));
+
+		struct stat info;
+		if(fstat(fd, &info) != 0){ return error::OpenFailed; }
+		length = x::usize(info.st_size);
+		if(length == 0){ return error::None; }
+
+		// The mapping outlives the descriptor
+		auto ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(ptr == MAP_FAILED){
+			length = 0;
+			return error::MapFailed;
+		}
+		base = static_cast<x::u8 const*>(ptr);
+		#endif
+
+		return error::None;
+	}
+
+	void close(){
+		#if defined(_WIN32)
+		if(base != nullptr){ UnmapViewOfFile(base); }
+		if(mapping != nullptr){ CloseHandle(mapping); }
+		if(file != INVALID_HANDLE_VALUE){ CloseHandle(file); }
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+		#else
+		if(base != nullptr){ munmap(const_cast<x::u8*>(base), length); }
+		#endif
+		base = nullptr;
+		length = 0;
+	}
+
+	mapped_file(){}
+
+	mapped_file(mapped_file const&) = delete;
+	void operator=(mapped_file const&) = delete;
+
+	mapped_file(mapped_file&& f){
+		take(f);
+	}
+
+	void operator=(mapped_file&& f){
+		close();
+		take(f);
+	}
+
+	~mapped_file(){
+		close();
+	}
+
+private:
+	void take(mapped_file& f){
+		base   = x::exchange(f.base, nullptr);
+		length = x::exchange(f.length, 0);
+		#if defined(_WIN32)
+		file    = x::exchange(f.file, INVALID_HANDLE_VALUE);
+		mapping = x::exchange(f.mapping, nullptr);
+		#endif
+	}
+
+	x::u8 const* base = nullptr;
+	x::usize length = 0;
+	#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+	#endif
+};
+
+#endif /* Include guard */
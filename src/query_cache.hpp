@@ -0,0 +1,272 @@
+#ifndef _query_cache_hpp_include_
+#define _query_cache_hpp_include_
+
+#include "core.hpp"
+
+// Memory for query results that stay valid while a graph does not change.
+// The owner decides when they are stale, usually by comparing a version that
+// every change bumps, and clears them. Both containers own copies of what is
+// stored in them and hand out copies made with the caller's allocator, so a
+// result stays valid and private however the cache changes afterwards.
+//
+// The copy makes a hit cost O(size of the result), in time and in memory from
+// the caller's allocator. A hit only saves the query itself, which is worth it
+// for results that take much longer to compute than to copy, like a closure
+// (O(V+E) for O(V) values) or the reachability matrix (V searches for V*V).
+
+// Slices keyed by K, within a budget in bytes. Storing past the budget evicts
+// the least recently used entries, values larger than the whole budget are
+// not stored at all. Entries live in a pool of slots linked from most to
+// least recently used. Finding an entry and updating the order take O(1),
+// copying the value in or out takes O(value.size()).
+template<typename K, typename T>
+struct lru_cache {
+	static constexpr x::usize none = ~x::usize(0);
+
+	x::usize size() const {
+		return index.size();
+	}
+
+	x::usize bytes_used() const {
+		return used;
+	}
+
+	x::usize budget() const {
+		return max_bytes;
+	}
+
+	// Copy of the value cached for key, allocated with al, in
+	// O(value.size()). The entry becomes the most recently used one.
+	// Misses if the copy could not be allocated.
+	x::pair<x::slice<T>, bool> get(K const& key, x::allocator al){
+		auto [slot, ok] = index.get(key);
+		if(!ok){ return {x::slice<T>{}, false}; }
+
+		auto value = entries[slot].value;
+		auto [copy, err] = x::make_slice_checked<T>(al, value.size());
+		if(!x::error_ok(err)){ return {x::slice<T>{}, false}; }
+		for(x::usize i = 0; i < value.size(); i += 1){
+			copy[i] = value[i];
+		}
+
+		unlink(slot);
+		push_front(slot);
+		return {copy, true};
+	}
+
+	// Store a copy of value under key. Returns false if it is larger than
+	// the budget or could not be allocated.
+	bool put(K const& key, x::view<T> value){
+		auto [old, found] = index.get(key);
+		if(found){ evict(old); }
+
+		auto bytes = value.size() * sizeof(T);
+		if(bytes > max_bytes){ return false; }
+		while((used + bytes > max_bytes) && (tail != none)){
+			evict(tail);
+		}
+
+		auto [copy, err] = x::make_slice_checked<T>(backing_allocator, value.size());
+		if(!x::error_ok(err)){ return false; }
+		for(x::usize i = 0; i < value.size(); i += 1){
+			copy[i] = value[i];
+		}
+
+		x::usize slot;
+		if(!free_slots.empty()){
+			slot = free_slots[free_slots.size() - 1];
+			free_slots.pop();
+			entries[slot] = entry{key, copy, none, none};
+		}
+		else {
+			slot = entries.size();
+			entries.append(entry{key, copy, none, none});
+		}
+		if(!index.set(key, slot)){
+			x::destroy(backing_allocator, copy);
+			free_slots.append(slot);
+			return false;
+		}
+
+		push_front(slot);
+		used += bytes;
+		return true;
+	}
+
+	// Drop every entry
+	void clear(){
+		while(tail != none){
+			evict(tail);
+		}
+	}
+
+	lru_cache(x::allocator al, x::usize budget_bytes)
+		: backing_allocator{al}, index(al), entries(al), free_slots(al), max_bytes{budget_bytes} {}
+
+	lru_cache(lru_cache const&) = delete;
+	void operator=(lru_cache const&) = delete;
+
+	lru_cache(lru_cache&& c)
+		: backing_allocator{c.backing_allocator},
+		index{x::move(c.index)},
+		entries{x::move(c.entries)},
+		free_slots{x::move(c.free_slots)},
+		head{x::exchange(c.head, none)},
+		tail{x::exchange(c.tail, none)},
+		used{x::exchange(c.used, 0)},
+		max_bytes{c.max_bytes} {}
+
+	void operator=(lru_cache&& c){
+		clear();
+		backing_allocator = c.backing_allocator;
+		index      = x::move(c.index);
+		entries    = x::move(c.entries);
+		free_slots = x::move(c.free_slots);
+		head       = x::exchange(c.head, none);
+		tail       = x::exchange(c.tail, none);
+		used       = x::exchange(c.used, 0);
+		max_bytes  = c.max_bytes;
+	}
+
+	~lru_cache(){
+		clear();
+	}
+
+private:
+	struct entry {
+		K key;
+		x::slice<T> value;
+		x::usize prev;
+		x::usize next;
+	};
+
+	void push_front(x::usize slot){
+		entries[slot].prev = none;
+		entries[slot].next = head;
+		if(head != none){ entries[head].prev = slot; }
+		head = slot;
+		if(tail == none){ tail = slot; }
+	}
+
+	void unlink(x::usize slot){
+		auto& e = entries[slot];
+		if(e.prev != none){ entries[e.prev].next = e.next; } else { head = e.next; }
+		if(e.next != none){ entries[e.next].prev = e.prev; } else { tail = e.prev; }
+	}
+
+	void evict(x::usize slot){
+		unlink(slot);
+		auto& e = entries[slot];
+		used -= e.value.size() * sizeof(T);
+		index.del(e.key);
+		x::destroy(backing_allocator, e.value);
+		e.value = x::slice<T>{};
+		free_slots.append(slot);
+	}
+
+	x::allocator backing_allocator;
+	x::hash_map<K, x::usize> index;
+	x::dynamic_array<entry> entries;
+	x::dynamic_array<x::usize> free_slots;
+	x::usize head = none;
+	x::usize tail = none;
+	x::usize used = 0;
+	x::usize max_bytes = 0;
+};
+
+// A list of rows, like a matrix or a list of groups, copied into one block
+template<typename T>
+struct cached_rows {
+	bool empty() const {
+		return !stored;
+	}
+
+	// Copy of the stored rows allocated with al, O(rows plus their
+	// elements). Misses when nothing is stored or the copy could not be
+	// allocated.
+	x::pair<x::slice<x::slice<T>>, bool> get(x::allocator al) const {
+		if(!stored){ return {x::slice<x::slice<T>>{}, false}; }
+		auto [copy, copy_data] = copy_rows(rows, al);
+		return {copy, copy.size() == rows.size()};
+	}
+
+	// Replace the stored rows with a copy of src. Stays empty if it could
+	// not be allocated.
+	void put(x::slice<x::slice<T>> src){
+		clear();
+		auto [new_rows, new_data] = copy_rows(src, backing_allocator);
+		if(new_rows.size() != src.size()){ return; }
+
+		rows = new_rows;
+		data = new_data;
+		stored = true;
+	}
+
+	void clear(){
+		x::destroy(backing_allocator, rows);
+		x::destroy(backing_allocator, data);
+		rows = x::slice<x::slice<T>>{};
+		data = x::slice<T>{};
+		stored = false;
+	}
+
+	explicit
+	cached_rows(x::allocator al)
+		: backing_allocator{al} {}
+
+	cached_rows(cached_rows const&) = delete;
+	void operator=(cached_rows const&) = delete;
+
+	cached_rows(cached_rows&& c)
+		: backing_allocator{c.backing_allocator}
+	{
+		rows   = x::exchange(c.rows, x::slice<x::slice<T>>{});
+		data   = x::exchange(c.data, x::slice<T>{});
+		stored = x::exchange(c.stored, false);
+	}
+
+	void operator=(cached_rows&& c){
+		clear();
+		backing_allocator = c.backing_allocator;
+		rows   = x::exchange(c.rows, x::slice<x::slice<T>>{});
+		data   = x::exchange(c.data, x::slice<T>{});
+		stored = x::exchange(c.stored, false);
+	}
+
+	~cached_rows(){
+		clear();
+	}
+
+private:
+	// Rows of src copied into one block, both slices are empty if either
+	// allocation failed
+	static x::pair<x::slice<x::slice<T>>, x::slice<T>> copy_rows(x::slice<x::slice<T>> src, x::allocator al){
+		x::usize total = 0;
+		for(auto r : src){ total += r.size(); }
+
+		auto [new_rows, err] = x::make_slice_checked<x::slice<T>>(al, src.size());
+		if(!x::error_ok(err)){ return {}; }
+		auto [new_data, data_err] = x::make_slice_checked<T>(al, total);
+		if(!x::error_ok(data_err)){
+			x::destroy(al, new_rows);
+			return {};
+		}
+
+		x::usize pos = 0;
+		for(x::usize i = 0; i < src.size(); i += 1){
+			new_rows[i] = new_data.sub(pos, pos + src[i].size());
+			for(x::usize j = 0; j < src[i].size(); j += 1){
+				new_rows[i][j] = src[i][j];
+			}
+			pos += src[i].size();
+		}
+		return {new_rows, new_data};
+	}
+
+	x::allocator backing_allocator;
+	x::slice<x::slice<T>> rows;
+	x::slice<T> data;
+	bool stored = false;
+};
+
+#endif /* Include guard */
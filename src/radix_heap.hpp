@@ -0,0 +1,119 @@
+#ifndef _radix_heap_hpp_include_
+#define _radix_heap_hpp_include_
+
+#include "core.hpp"
+
+// Monotone priority queue over u64 keys: pop() hands out the smallest key, and
+// no key pushed may be smaller than the last one popped, which is always true
+// for Dijkstra's algorithm. Entries are kept in buckets by the highest bit in
+// which they differ from the last popped key. When the first bucket runs dry,
+// the next non-empty one is emptied into lower buckets, so an entry moves at
+// most 64 times and nothing is ever compared against more than one bucket.
+template<typename T>
+struct radix_heap {
+	static constexpr x::usize bucket_count = 65;
+
+	struct entry {
+		x::u64 key;
+		T value;
+	};
+
+	x::usize size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	// Smallest key popped so far
+	x::u64 last_key() const {
+		return last;
+	}
+
+	void push(x::u64 key, T const& value){
+		x::panic_assert(key >= last, "push() of a key smaller than the last popped one");
+		append(bucket_of(key), entry{key, value});
+		count += 1;
+	}
+
+	// Remove an entry with the smallest key, the heap must not be empty
+	entry pop(){
+		x::panic_assert(count > 0, "pop() from empty heap");
+		if(lengths[0] == 0){
+			refill();
+		}
+		count -= 1;
+		lengths[0] -= 1;
+		return buckets[0][lengths[0]];
+	}
+
+	// Drop every entry, bucket storage is kept
+	void clear(){
+		for(auto& n : lengths){
+			n = 0;
+		}
+		count = 0;
+		last = 0;
+	}
+
+	radix_heap(x::allocator al)
+		: backing_allocator{al} {}
+
+	radix_heap(radix_heap const&) = delete;
+	void operator=(radix_heap const&) = delete;
+
+	~radix_heap(){
+		for(auto& b : buckets){
+			x::destroy(backing_allocator, b);
+		}
+	}
+
+private:
+	void append(x::usize bucket, entry const& e){
+		auto& b = buckets[bucket];
+		auto& n = lengths[bucket];
+		if(n == b.size()){
+			auto grown = x::make_slice<entry>(backing_allocator, x::max(b.size() * 2, x::usize(16)));
+			for(x::usize i = 0; i < n; i += 1){
+				grown[i] = b[i];
+			}
+			x::destroy(backing_allocator, b);
+			b = grown;
+		}
+		b[n] = e;
+		n += 1;
+	}
+
+	x::usize bucket_of(x::u64 key) const {
+		return (key == last) ? 0 : x::usize(64 - std::countl_zero(key ^ last));
+	}
+
+	// Move the entries of the first non-empty bucket down, the smallest of
+	// them becomes the new last key and lands in bucket 0.
+	void refill(){
+		x::usize i = 1;
+		while(lengths[i] == 0){ i += 1; }
+
+		auto source = buckets[i].sub(0, lengths[i]);
+		auto smallest = source[0].key;
+		for(auto const& e : source){
+			smallest = x::min(smallest, e.key);
+		}
+		last = smallest;
+
+		// Every entry goes to a bucket below i, source is left alone
+		for(auto const& e : source){
+			append(bucket_of(e.key), e);
+		}
+		lengths[i] = 0;
+	}
+
+	x::allocator backing_allocator;
+	x::slice<entry> buckets[bucket_count];
+	x::usize lengths[bucket_count] = {};
+	x::usize count = 0;
+	x::u64 last = 0;
+};
+
+#endif /* Include guard */
@@ -0,0 +1,310 @@
+#ifndef _reachability_index_hpp_include_
+#define _reachability_index_hpp_include_
+
+#include "core.hpp"
+
+// Reachability queries in O(V + E_dag) memory, where E_dag counts the distinct
+// edges between different components, never more than the graph's edges.
+// Nodes of a strongly connected component all reach each other, so the index
+// works on the components, which form a DAG, and keeps the component of every
+// node plus the DAG edges.
+//
+// Every component gets one interval per randomized depth first traversal of
+// the DAG (GRAIL): its rank in post order and the lowest rank below it.
+// Whatever a component reaches has its intervals nested in the component's,
+// so a single interval that is not nested proves there is no path, which
+// settles most negative queries in O(traversals). Components are numbered
+// sinks first, so a component never reaches a higher numbered one, which
+// rules out about half of the pairs for free. The ranks of the spanning tree
+// of a traversal below a component are contiguous as well, a target in that
+// range is reachable for sure. Queries that none of this settles search the
+// DAG, only entering components whose intervals hold the target.
+//
+// Queries share scratch memory, they must not run concurrently.
+struct reachability_index {
+	static constexpr x::usize default_traversals = 4;
+
+	// Number of nodes, 0 until built
+	x::usize size() const {
+		return components.size();
+	}
+
+	x::usize component_count() const {
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+
+	x::u32 component(x::usize node) const {
+		return components[node];
+	}
+
+	// Whether to can be reached from `from`, every node reaches itself
+	bool reachable(x::usize from, x::usize to) const {
+		auto a = components[from];
+		auto b = components[to];
+		if(a == b){ return true; }
+		if(a < b){ return false; }
+		if(!nested(b, a)){ return false; }
+		if(in_tree(b, a)){ return true; }
+		return search(a, b);
+	}
+
+	// Index g, given the component of each node and the number of
+	// components. Components must be numbered in reverse topological order,
+	// as tarjan_components() does.
+	template<typename Graph>
+	void build(Graph const& g, x::view<x::usize> comp, x::usize count,
+		x::usize traversal_count = default_traversals, x::u64 seed = 0)
+	{
+		release();
+		auto n = g.size();
+		traversals = x::max(traversal_count, x::usize(1));
+
+		components = x::make_slice<x::u32>(backing_allocator, n);
+		for(x::usize v = 0; v < n; v += 1){
+			components[v] = x::u32(comp[v]);
+		}
+
+		// Group the nodes by component, so the edges of each component can
+		// be deduplicated with a marker instead of a set.
+		auto first = x::make_slice<x::usize>(backing_allocator, count + 1);
+		Defer(x::destroy(backing_allocator, first));
+		auto members = x::make_slice<x::u32>(backing_allocator, n);
+		Defer(x::destroy(backing_allocator, members));
+		for(x::usize v = 0; v < n; v += 1){
+			first[comp[v] + 1] += 1;
+		}
+		for(x::usize c = 1; c <= count; c += 1){
+			first[c] += first[c - 1];
+		}
+		for(x::usize v = 0; v < n; v += 1){
+			auto& pos = first[comp[v]];
+			members[pos] = x::u32(v);
+			pos += 1;
+		}
+
+		constexpr auto unmarked = ~x::u32(0);
+		auto marked_by = x::make_slice<x::u32>(backing_allocator, count);
+		Defer(x::destroy(backing_allocator, marked_by));
+		for(auto& m : marked_by){ m = unmarked; }
+
+		offsets = x::make_slice<x::usize>(backing_allocator, count + 1);
+		auto edges = x::dynamic_array<x::u32>(backing_allocator);
+		x::usize m = 0;
+		for(x::usize c = 0; c < count; c += 1){
+			offsets[c] = edges.size();
+			// first[c] was moved to the end of c by the grouping above
+			for(; m < first[c]; m += 1){
+				g.for_each_neighbor(members[m], [&](x::usize w){
+					auto cw = x::u32(comp[w]);
+					if((cw == c) || (marked_by[cw] == c)){ return; }
+					marked_by[cw] = x::u32(c);
+					edges.append(cw);
+				});
+			}
+		}
+		offsets[count] = edges.size();
+		targets = edges.extract_data();
+
+		intervals = x::make_slice<x::u32>(backing_allocator, count * traversals * 3);
+		stamps = x::make_slice<x::u32>(backing_allocator, count);
+		epoch = 0;
+		for(x::usize t = 0; t < traversals; t += 1){
+			label(t, x::hash(seed + t + 1));
+		}
+	}
+
+	explicit
+	reachability_index(x::allocator al)
+		: backing_allocator{al}, stack(al) {}
+
+	reachability_index(reachability_index const&) = delete;
+	void operator=(reachability_index const&) = delete;
+
+	reachability_index(reachability_index&& r)
+		: backing_allocator{r.backing_allocator}, stack{x::move(r.stack)}
+	{
+		take(r);
+	}
+
+	void operator=(reachability_index&& r){
+		release();
+		backing_allocator = r.backing_allocator;
+		stack = x::move(r.stack);
+		take(r);
+	}
+
+	~reachability_index(){
+		release();
+	}
+
+	// Forget the graph, size() becomes 0
+	void clear(){
+		release();
+	}
+
+private:
+	struct frame {
+		x::u32 comp;
+		x::u32 step;
+	};
+
+	x::u32 low(x::usize comp, x::usize t) const {
+		return intervals[(comp * traversals + t) * 3];
+	}
+
+	x::u32 rank(x::usize comp, x::usize t) const {
+		return intervals[(comp * traversals + t) * 3 + 1];
+	}
+
+	// Lowest rank of the spanning tree below comp
+	x::u32 tree_low(x::usize comp, x::usize t) const {
+		return intervals[(comp * traversals + t) * 3 + 2];
+	}
+
+	bool in_tree(x::usize inner, x::usize outer) const {
+		for(x::usize t = 0; t < traversals; t += 1){
+			auto r = rank(inner, t);
+			if((r >= tree_low(outer, t)) && (r <= rank(outer, t))){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool nested(x::usize inner, x::usize outer) const {
+		for(x::usize t = 0; t < traversals; t += 1){
+			if((low(inner, t) < low(outer, t)) || (rank(inner, t) > rank(outer, t))){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Depth first search of the DAG from component `from`
+	bool search(x::u32 from, x::u32 to) const {
+		next_epoch();
+		stack.clear();
+		stack.append(frame{from, 0});
+		stamps[from] = epoch;
+
+		while(!stack.empty()){
+			auto c = stack[stack.size() - 1].comp;
+			stack.pop();
+			for(auto i = offsets[c]; i < offsets[c + 1]; i += 1){
+				auto d = targets[i];
+				if(d == to){ return true; }
+				if((d < to) || (stamps[d] == epoch)){ continue; }
+				stamps[d] = epoch;
+				if(!nested(to, d)){ continue; }
+				if(in_tree(to, d)){ return true; }
+				stack.append(frame{d, 0});
+			}
+		}
+		return false;
+	}
+
+	// Intervals of traversal t. Roots are taken from the highest component
+	// down, which is a topological order, so only sources become roots.
+	// Children are visited from a random position on.
+	void label(x::usize t, x::u64 seed){
+		auto count = component_count();
+		next_epoch();
+		x::u32 counter = 0;
+
+		auto child = [&](x::u32 c, x::u32 step){
+			auto degree = offsets[c + 1] - offsets[c];
+			auto start = x::hash(seed ^ c) % degree;
+			return targets[offsets[c] + (start + step) % degree];
+		};
+		// Low, rank and tree low of c
+		auto entry = [&](x::u32 c){
+			return &intervals[(c * traversals + t) * 3];
+		};
+		auto discover = [&](x::u32 c){
+			stamps[c] = epoch;
+			entry(c)[0] = ~x::u32(0);
+			entry(c)[2] = counter + 1;
+			stack.append(frame{c, 0});
+		};
+
+		for(x::usize root = count; root > 0; root -= 1){
+			auto r = x::u32(root - 1);
+			if(stamps[r] == epoch){ continue; }
+			stack.clear();
+			discover(r);
+
+			while(!stack.empty()){
+				auto& top = stack[stack.size() - 1];
+				auto c = top.comp;
+
+				if(top.step < offsets[c + 1] - offsets[c]){
+					auto d = child(c, top.step);
+					top.step += 1;
+					if(stamps[d] == epoch){
+						// Finished already, there are no cycles
+						entry(c)[0] = x::min(entry(c)[0], entry(d)[0]);
+						continue;
+					}
+					discover(d);
+					continue;
+				}
+
+				counter += 1;
+				entry(c)[1] = counter;
+				entry(c)[0] = x::min(entry(c)[0], counter);
+				stack.pop();
+				if(!stack.empty()){
+					auto p = stack[stack.size() - 1].comp;
+					entry(p)[0] = x::min(entry(p)[0], entry(c)[0]);
+				}
+			}
+		}
+	}
+
+	void next_epoch() const {
+		if(epoch == ~x::u32(0)){
+			x::mem_set(stamps.raw_data(), 0, stamps.size() * sizeof(x::u32));
+			epoch = 0;
+		}
+		epoch += 1;
+	}
+
+	void take(reachability_index& r){
+		components = x::exchange(r.components, x::slice<x::u32>{});
+		offsets    = x::exchange(r.offsets, x::slice<x::usize>{});
+		targets    = x::exchange(r.targets, x::slice<x::u32>{});
+		intervals  = x::exchange(r.intervals, x::slice<x::u32>{});
+		stamps     = x::exchange(r.stamps, x::slice<x::u32>{});
+		traversals = x::exchange(r.traversals, 0);
+		epoch      = x::exchange(r.epoch, 0);
+	}
+
+	void release(){
+		x::destroy(backing_allocator, components);
+		x::destroy(backing_allocator, offsets);
+		x::destroy(backing_allocator, targets);
+		x::destroy(backing_allocator, intervals);
+		x::destroy(backing_allocator, stamps);
+		components = x::slice<x::u32>{};
+		offsets    = x::slice<x::usize>{};
+		targets    = x::slice<x::u32>{};
+		intervals  = x::slice<x::u32>{};
+		stamps     = x::slice<x::u32>{};
+		traversals = 0;
+		epoch      = 0;
+	}
+
+	x::allocator backing_allocator;
+	x::slice<x::u32> components;
+	x::slice<x::usize> offsets;
+	x::slice<x::u32> targets;
+	// Low, rank and tree low of every traversal, the ones of a component are
+	// adjacent
+	x::slice<x::u32> intervals;
+	x::usize traversals = 0;
+	mutable x::slice<x::u32> stamps;
+	mutable x::u32 epoch = 0;
+	mutable x::dynamic_array<frame> stack;
+};
+
+#endif /* Include guard */
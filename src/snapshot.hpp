@@ -0,0 +1,450 @@
+#ifndef _snapshot_hpp_include_
+#define _snapshot_hpp_include_
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "bit_matrix.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <algorithm>
+
+// Binary graph snapshots. A snapshot is a header followed by sections of raw
+// arrays, each one starting on a 64 byte boundary:
+//
+//   Offsets, Neighbors      forward CSR lists (u64, u32)
+//   InOffsets, InNeighbors  reverse CSR lists (u64, u32)
+//   LabelOffsets, LabelBytes, LabelOrder
+//                           optional, label i is LabelBytes[LabelOffsets[i]..
+//                           LabelOffsets[i+1]], LabelOrder lists the nodes
+//                           sorted by label so lookups can binary search
+//   Components              optional, strongly connected component per node (u32)
+//   Reachability            optional, transitive closure as bit_matrix rows
+//
+// Opening one maps the file and checks the header against the file size,
+// arrays are then used in place, so it takes the same time for any graph.
+// Array contents are not validated: snapshots are trusted files written by
+// write_snapshot() on a machine with the same byte order.
+enum struct snapshot_error : x::i32 {
+	None = 0,
+	OpenFailed,
+	WriteFailed,
+	BadMagic,
+	BadVersion,
+	BadByteOrder,
+	BadLayout,
+};
+
+namespace snapshot_impl {
+using x::usize, x::u8, x::u32, x::u64, x::error_ok;
+
+static_assert(sizeof(usize) == sizeof(u64), "Snapshot offsets are stored as u64");
+
+constexpr u8 magic[8] = {'X', 'G', 'R', 'A', 'P', 'H', 'S', 'N'};
+constexpr u32 version = 1;
+constexpr u32 byte_order_mark = 0x01020304;
+constexpr usize alignment = 64;
+
+enum section_id : u32 {
+	Offsets = 0,
+	Neighbors,
+	InOffsets,
+	InNeighbors,
+	LabelOffsets,
+	LabelBytes,
+	LabelOrder,
+	Components,
+	Reachability,
+	SectionCount,
+};
+
+struct section {
+	u64 offset; // From the start of the file
+	u64 size;   // In bytes
+};
+
+struct header {
+	u8  magic[8];
+	u32 version;
+	u32 byte_order;
+	u64 node_count;
+	u64 edge_count;
+	u64 component_count;
+	u64 reachability_stride; // Words per closure row
+	section sections[SectionCount];
+};
+
+// Arrays handed out by a snapshot live in the mapping, freeing them is a no-op
+inline
+x::allocator borrowed_allocator(){
+	auto proc = [](void*, x::allocator::operation op, usize, usize, void*, usize, x::source_location const&)
+		-> x::pair<void*, x::allocator::error>
+	{
+		if(op == x::allocator::operation::Free){
+			return {nullptr, x::allocator::error::None};
+		}
+		return {nullptr, x::allocator::error::UnsupportedOperation};
+	};
+	return x::allocator(nullptr, proc);
+}
+
+// Sequential writer that pads every section to the alignment
+struct section_writer {
+	FILE* file;
+	u64 pos = 0;
+	bool ok = true;
+
+	void write(void const* data, usize bytes){
+		if(bytes == 0){ return; }
+		ok = ok && (fwrite(data, 1, bytes, file) == bytes);
+		pos += bytes;
+	}
+
+	void pad(){
+		static constexpr u8 zeros[alignment] = {};
+		auto rem = pos % alignment;
+		if(rem != 0){ write(zeros, alignment - rem); }
+	}
+};
+
+}
+
+// Memory mapped, read only graph. It follows the same interface as the other
+// graphs, so the traversal templates run on it directly.
+struct graph_snapshot {
+	csr_adjacency adjacency{snapshot_impl::borrowed_allocator()};
+
+	x::usize size() const {
+		return adjacency.size();
+	}
+
+	x::usize edge_count() const {
+		return adjacency.edge_count();
+	}
+
+	x::usize degree(x::usize node) const {
+		return adjacency.degree(node);
+	}
+
+	template<typename Func>
+	void for_each_neighbor(x::usize node, Func&& fn) const {
+		adjacency.for_each_neighbor(node, x::forward<Func>(fn));
+	}
+
+	// Weights are not saved, every edge of a snapshot weighs 1
+	template<typename Func>
+	void for_each_weighted_neighbor(x::usize node, Func&& fn) const {
+		adjacency.for_each_weighted_neighbor(node, x::forward<Func>(fn));
+	}
+
+	x::isize next_neighbor(x::usize node, x::usize& cursor) const {
+		return adjacency.next_neighbor(node, cursor);
+	}
+
+	x::isize next_in_neighbor(x::usize node, x::usize& cursor) const {
+		return adjacency.next_in_neighbor(node, cursor);
+	}
+
+	bool has_labels() const {
+		return !label_offsets.empty();
+	}
+
+	x::view<x::u8> label(x::usize node) const {
+		return label_bytes.sub(label_offsets[node], label_offsets[node + 1]);
+	}
+
+	// Node with the given label, -1 if there is none
+	x::isize index_of(x::view<x::u8> name) const {
+		x::usize lo = 0, hi = label_order.size();
+		while(lo < hi){
+			auto mid = lo + (hi - lo) / 2;
+			if(label_less(label(label_order[mid]), name)){ lo = mid + 1; }
+			else { hi = mid; }
+		}
+		if((lo < label_order.size()) && x::slice_equal(label(label_order[lo]), name)){
+			return x::isize(label_order[lo]);
+		}
+		return -1;
+	}
+
+	bool has_components() const {
+		return !components.empty();
+	}
+
+	x::u32 component(x::usize node) const {
+		return components[node];
+	}
+
+	x::usize component_count() const {
+		return component_total;
+	}
+
+	bool has_reachability() const {
+		return !reachability.empty();
+	}
+
+	// Same meaning as the bits of reachability_bits()
+	bool reachable(x::usize from, x::usize to) const {
+		auto w = reachability[from * reachability_stride + (to / bit_matrix::word_bits)];
+		return (w >> (to % bit_matrix::word_bits)) & 1;
+	}
+
+	// Lexicographic byte order, shorter labels first on a tie
+	static bool label_less(x::view<x::u8> a, x::view<x::u8> b){
+		auto n = x::min(a.size(), b.size());
+		for(x::usize i = 0; i < n; i += 1){
+			if(a[i] != b[i]){ return a[i] < b[i]; }
+		}
+		return a.size() < b.size();
+	}
+
+	snapshot_error open(char const* path){
+		using namespace snapshot_impl;
+		close();
+
+		if(!x::error_ok(file.open(path))){
+			return snapshot_error::OpenFailed;
+		}
+
+		auto err = map_sections();
+		if(!x::error_ok(err)){ close(); }
+		return err;
+	}
+
+	void close(){
+		adjacency = csr_adjacency(snapshot_impl::borrowed_allocator());
+		label_offsets = {};
+		label_bytes = {};
+		label_order = {};
+		components = {};
+		reachability = {};
+		component_total = 0;
+		reachability_stride = 0;
+		file.close();
+	}
+
+	graph_snapshot(){}
+
+	graph_snapshot(graph_snapshot const&) = delete;
+	void operator=(graph_snapshot const&) = delete;
+
+	// Slices point into the mapping, which does not move with the object
+	graph_snapshot(graph_snapshot&& s)
+		: adjacency{x::move(s.adjacency)}, file{x::move(s.file)}
+	{
+		take(s);
+	}
+
+	void operator=(graph_snapshot&& s){
+		close();
+		adjacency = x::move(s.adjacency);
+		file = x::move(s.file);
+		take(s);
+	}
+
+	~graph_snapshot(){
+		close();
+	}
+
+private:
+	template<typename T>
+	x::slice<T> section_slice(snapshot_impl::header const& h, snapshot_impl::section_id id) const {
+		auto base = const_cast<x::u8*>(file.bytes().raw_data());
+		auto s = h.sections[id];
+		return x::slice<T>(reinterpret_cast<T*>(base + s.offset), s.size / sizeof(T));
+	}
+
+	snapshot_error map_sections(){
+		using namespace snapshot_impl;
+		auto bytes = file.bytes();
+		if(bytes.size() < sizeof(header)){ return snapshot_error::BadMagic; }
+
+		header h;
+		x::mem_copy(&h, bytes.raw_data(), sizeof(header));
+
+		if(!x::slice_equal(x::view<u8>(h.magic, 8), x::view<u8>(magic, 8))){ return snapshot_error::BadMagic; }
+		if(h.version != version){ return snapshot_error::BadVersion; }
+		if(h.byte_order != byte_order_mark){ return snapshot_error::BadByteOrder; }
+
+		auto n = h.node_count;
+		auto e = h.edge_count;
+		if((n >= u64(~u32(0))) || (e > (bytes.size() / sizeof(u32)))){
+			return snapshot_error::BadLayout;
+		}
+
+		auto fits = [&](section_id id, u64 want, bool optional) -> bool {
+			auto s = h.sections[id];
+			if(optional && (s.size == 0)){ return true; }
+			return (s.size == want) && (s.offset % alignment == 0) &&
+				(s.offset <= bytes.size()) && (s.size <= bytes.size() - s.offset);
+		};
+
+		auto row_bytes = h.reachability_stride * sizeof(u64);
+		bool ok = fits(Offsets, (n + 1) * sizeof(u64), false) &&
+			fits(Neighbors, e * sizeof(u32), false) &&
+			fits(InOffsets, (n + 1) * sizeof(u64), false) &&
+			fits(InNeighbors, e * sizeof(u32), false) &&
+			fits(LabelOffsets, (n + 1) * sizeof(u64), true) &&
+			fits(LabelBytes, h.sections[LabelBytes].size, true) &&
+			fits(LabelOrder, n * sizeof(u32), true) &&
+			fits(Components, n * sizeof(u32), true) &&
+			((h.reachability_stride == 0) || (h.reachability_stride == bit_matrix::words_for(n))) &&
+			fits(Reachability, n * row_bytes, true);
+		if(!ok){ return snapshot_error::BadLayout; }
+
+		// Labels come as a set, the order is empty for an empty graph
+		auto has_labels = h.sections[LabelOffsets].size != 0;
+		auto order_size = has_labels ? n * sizeof(u32) : 0;
+		if(h.sections[LabelOrder].size != order_size){ return snapshot_error::BadLayout; }
+
+		auto offsets = section_slice<usize>(h, Offsets);
+		auto in_offsets = section_slice<usize>(h, InOffsets);
+		if((offsets[n] != e) || (in_offsets[n] != e)){ return snapshot_error::BadLayout; }
+
+		label_offsets = section_slice<usize>(h, LabelOffsets);
+		label_bytes   = section_slice<u8>(h, LabelBytes);
+		label_order   = section_slice<u32>(h, LabelOrder);
+		if(has_labels && (label_offsets[n] != label_bytes.size())){ return snapshot_error::BadLayout; }
+
+		components = section_slice<u32>(h, Components);
+		component_total = components.empty() ? 0 : h.component_count;
+		reachability = section_slice<u64>(h, Reachability);
+		reachability_stride = h.reachability_stride;
+
+		adjacency = csr_adjacency(borrowed_allocator(),
+			offsets, section_slice<u32>(h, Neighbors),
+			in_offsets, section_slice<u32>(h, InNeighbors));
+
+		return snapshot_error::None;
+	}
+
+	void take(graph_snapshot& s){
+		label_offsets = x::exchange(s.label_offsets, x::view<x::usize>{});
+		label_bytes   = x::exchange(s.label_bytes, x::view<x::u8>{});
+		label_order   = x::exchange(s.label_order, x::view<x::u32>{});
+		components    = x::exchange(s.components, x::view<x::u32>{});
+		reachability  = x::exchange(s.reachability, x::view<x::u64>{});
+		component_total     = x::exchange(s.component_total, 0);
+		reachability_stride = x::exchange(s.reachability_stride, 0);
+	}
+
+	mapped_file file;
+	x::view<x::usize> label_offsets;
+	x::view<x::u8> label_bytes;
+	x::view<x::u32> label_order;
+	x::view<x::u32> components;
+	x::view<x::u64> reachability;
+	x::usize component_total = 0;
+	x::usize reachability_stride = 0;
+};
+
+// Write adjacency, and whatever optional data is given, as a snapshot.
+// label(i) returns the bytes of node i's label, pass nullptr to leave labels
+// out. components holds a component id per node or is empty, reachability can
+// be null.
+template<typename LabelFunc>
+snapshot_error write_snapshot(char const* path, csr_adjacency const& adj, LabelFunc&& label,
+	x::view<x::usize> components, x::usize component_count, bit_matrix const* reachability)
+{
+	using namespace snapshot_impl;
+	auto heap = x::std_heap_allocator();
+	constexpr bool with_labels = !x::typing::same_as<LabelFunc, decltype(nullptr)>;
+	auto n = adj.size();
+	auto e = adj.edge_count();
+
+	auto label_offsets = x::slice<usize>();
+	auto label_order = x::slice<u32>();
+	Defer({
+		x::destroy(heap, label_offsets);
+		x::destroy(heap, label_order);
+	});
+	if constexpr(with_labels){
+		label_offsets = x::make_slice<usize>(heap, n + 1);
+		label_order = x::make_slice<u32>(heap, n);
+		for(usize i = 0; i < n; i += 1){
+			label_offsets[i + 1] = label_offsets[i] + label(i).size();
+			label_order[i] = u32(i);
+		}
+		std::sort(label_order.raw_data(), label_order.raw_data() + n, [&](u32 a, u32 b){
+			return graph_snapshot::label_less(label(a), label(b));
+		});
+	}
+
+	header h = {};
+	x::mem_copy(h.magic, magic, sizeof(magic));
+	h.version = version;
+	h.byte_order = byte_order_mark;
+	h.node_count = n;
+	h.edge_count = e;
+	h.component_count = components.empty() ? 0 : component_count;
+	h.reachability_stride = (reachability != nullptr) ? bit_matrix::words_for(n) : 0;
+
+	usize sizes[SectionCount] = {};
+	sizes[Offsets]      = (n + 1) * sizeof(u64);
+	sizes[Neighbors]    = e * sizeof(u32);
+	sizes[InOffsets]    = (n + 1) * sizeof(u64);
+	sizes[InNeighbors]  = e * sizeof(u32);
+	sizes[LabelOffsets] = label_offsets.size() * sizeof(u64);
+	sizes[LabelBytes]   = label_offsets.empty() ? 0 : label_offsets[n];
+	sizes[LabelOrder]   = label_order.size() * sizeof(u32);
+	sizes[Components]   = components.empty() ? 0 : n * sizeof(u32);
+	sizes[Reachability] = n * h.reachability_stride * sizeof(u64);
+
+	u64 pos = x::align_forward(u64(sizeof(header)), u64(alignment));
+	for(u32 id = 0; id < SectionCount; id += 1){
+		h.sections[id] = {pos, sizes[id]};
+		pos = x::align_forward(pos + sizes[id], u64(alignment));
+	}
+
+	// An empty adjacency may have no offsets at all, the lists of a graph
+	// without nodes are a lone 0
+	static constexpr usize no_offsets[1] = {};
+	auto offsets = adj.offsets.empty() ? no_offsets : adj.offsets.raw_data();
+	auto in_offsets = adj.in_offsets.empty() ? no_offsets : adj.in_offsets.raw_data();
+
+	auto file = fopen(path, "wb");
+	if(file == nullptr){ return snapshot_error::OpenFailed; }
+	auto out = section_writer{file};
+
+	out.write(&h, sizeof(h));
+	out.pad();
+	out.write(offsets, sizes[Offsets]);
+	out.pad();
+	out.write(adj.neighbors.raw_data(), sizes[Neighbors]);
+	out.pad();
+	out.write(in_offsets, sizes[InOffsets]);
+	out.pad();
+	out.write(adj.in_neighbors.raw_data(), sizes[InNeighbors]);
+	out.pad();
+	out.write(label_offsets.raw_data(), sizes[LabelOffsets]);
+	out.pad();
+	if constexpr(with_labels){
+		for(usize i = 0; i < n; i += 1){
+			auto name = label(i);
+			out.write(name.raw_data(), name.size());
+		}
+	}
+	out.pad();
+	out.write(label_order.raw_data(), sizes[LabelOrder]);
+	out.pad();
+	if(!components.empty()){
+		for(usize i = 0; i < n; i += 1){
+			auto id = u32(components[i]);
+			out.write(&id, sizeof(id));
+		}
+	}
+	out.pad();
+	if(reachability != nullptr){
+		for(usize r = 0; r < n; r += 1){
+			// Rows are cut down to the words in use, capacity is not stored
+			auto row = reachability->row(r);
+			out.write(row.raw_data(), h.reachability_stride * sizeof(u64));
+		}
+	}
+	out.pad();
+
+	auto closed = fclose(file) == 0;
+	return (out.ok && closed) ? snapshot_error::None : snapshot_error::WriteFailed;
+}
+
+#endif /* Include guard */
@@ -0,0 +1,558 @@
+#ifndef _versioned_graph_hpp_include_
+#define _versioned_graph_hpp_include_
+
+#include "core.hpp"
+
+#include <atomic>
+#include <new>
+
+// Graph shared by one writer thread and any number of reader threads. Readers
+// pin the current version, an immutable graph, and never take a lock; the
+// writer edits a private draft and publishes it with an atomic pointer swap.
+//
+// Adjacency and its transpose are bit matrices split in blocks of block_rows
+// rows. Versions only hold pointers to blocks and the draft copies a block the
+// first time one of its rows changes, so publishing after a few edge updates
+// costs a few blocks rather than the whole matrix. Node ids and the id -> slot
+// index are shared the same way, as a whole, and copied when nodes are added
+// or deleted.
+//
+// Old versions are reclaimed by epoch: a reader announces the epoch it pinned
+// in, every published version is retired with the epoch it was replaced in,
+// and the writer frees it once every announced epoch is later than that.
+// Reference counts are only ever touched by the writer.
+struct versioned_graph {
+	static constexpr x::usize block_rows = 64;
+	static constexpr x::usize max_readers = 64;
+	static constexpr x::u32 none = ~x::u32(0);
+
+	struct row_block {
+		// Versions, draft included, that point to this block
+		x::usize refs;
+		x::slice<x::u64> words;
+	};
+
+	struct node_index {
+		x::usize refs = 1;
+		// Node id of every slot, none for dead ones
+		x::dynamic_array<x::u32> ids;
+		x::hash_map<x::u32, x::usize> slots;
+
+		explicit
+		node_index(x::allocator al) : ids(al), slots(al) {}
+	};
+
+	// One immutable graph, with the interface of the Graph concept over its
+	// slots, so every traversal runs on it as is.
+	struct version {
+		// Published versions are numbered from 1 on
+		x::u64 number = 0;
+		x::usize stride = 0;
+		x::usize live = 0;
+		x::usize edge_total = 0;
+		x::slice<row_block*> blocks;
+		x::slice<row_block*> reverse_blocks;
+		node_index* index = nullptr;
+
+		// Number of slots, including dead ones
+		x::usize size() const {
+			return index->ids.size();
+		}
+
+		x::usize node_count() const {
+			return live;
+		}
+
+		x::usize edge_count() const {
+			return edge_total;
+		}
+
+		x::u32 node_id(x::usize slot) const {
+			return index->ids[slot];
+		}
+
+		bool alive(x::usize slot) const {
+			return node_id(slot) != none;
+		}
+
+		x::isize index_of(x::u32 id) const {
+			auto [slot, ok] = index->slots.get(id);
+			return ok ? x::isize(slot) : -1;
+		}
+
+		x::view<x::u64> row(x::usize slot) const {
+			return row_of(blocks, slot);
+		}
+
+		// Row of the transpose, the nodes with an edge into slot
+		x::view<x::u64> in_row(x::usize slot) const {
+			return row_of(reverse_blocks, slot);
+		}
+
+		bool connected(x::usize from, x::usize to) const {
+			return (row(from)[to / 64] >> (to % 64)) & 1;
+		}
+
+		x::usize degree(x::usize node) const {
+			x::usize total = 0;
+			for(auto w : row(node)){
+				total += std::popcount(w);
+			}
+			return total;
+		}
+
+		template<typename Func>
+		void for_each_neighbor(x::usize node, Func&& fn) const {
+			auto data = row(node);
+			for(x::usize i = 0; i < data.size(); i += 1){
+				auto w = data[i];
+				while(w != 0){
+					fn(i * 64 + x::usize(std::countr_zero(w)));
+					w &= w - 1;
+				}
+			}
+		}
+
+		x::isize next_neighbor(x::usize node, x::usize& cursor) const {
+			return next_in(row(node), cursor);
+		}
+
+		x::isize next_in_neighbor(x::usize node, x::usize& cursor) const {
+			return next_in(in_row(node), cursor);
+		}
+
+		x::view<x::u64> row_of(x::slice<row_block*> from, x::usize slot) const {
+			auto b = from[slot / block_rows];
+			auto r = slot % block_rows;
+			return x::view(b->words).sub(r * stride, (r + 1) * stride);
+		}
+
+	private:
+		x::isize next_in(x::view<x::u64> data, x::usize& cursor) const {
+			if(cursor >= size()){ return -1; }
+			auto i = cursor / 64;
+			auto w = data[i] & (~x::u64(0) << (cursor % 64));
+			while(1){
+				if(w != 0){
+					auto n = i * 64 + x::usize(std::countr_zero(w));
+					cursor = n + 1;
+					return x::isize(n);
+				}
+				i += 1;
+				if(i >= data.size()){ return -1; }
+				w = data[i];
+			}
+		}
+	};
+
+	// The version a reader pinned, released when this goes out of scope
+	struct pinned_version {
+		version const* operator->() const {
+			return ptr;
+		}
+
+		version const& operator*() const {
+			return *ptr;
+		}
+
+		pinned_version(versioned_graph* owner, x::usize reader, version const* ptr)
+			: owner{owner}, reader{reader}, ptr{ptr} {}
+
+		pinned_version(pinned_version const&) = delete;
+		void operator=(pinned_version const&) = delete;
+
+		pinned_version(pinned_version&& p)
+			: owner{x::exchange(p.owner, nullptr)}, reader{p.reader}, ptr{p.ptr} {}
+
+		~pinned_version(){
+			if(owner != nullptr){ owner->unpin(reader); }
+		}
+
+	private:
+		versioned_graph* owner;
+		x::usize reader;
+		version const* ptr;
+	};
+
+	// Reader threads ///////////////////////////////////////////////////////
+
+	// Reader slot for a thread, or none while all max_readers are taken
+	x::usize register_reader(){
+		for(x::usize i = 0; i < max_readers; i += 1){
+			bool expected = false;
+			if(readers[i].in_use.compare_exchange_strong(expected, true)){
+				return i;
+			}
+		}
+		return x::usize(none);
+	}
+
+	// Give a reader slot back, the reader must not hold a pin
+	void unregister_reader(x::usize reader){
+		x::bounds_check(reader < max_readers);
+		x::debug_assert(readers[reader].epoch.load() == 0, "Reader still holds a pinned version");
+		readers[reader].in_use.store(false);
+	}
+
+	// Pin the current version. Lock free, a reader may only hold one pin
+	// at a time.
+	pinned_version read(x::usize reader){
+		x::bounds_check(reader < max_readers);
+		readers[reader].epoch.store(epoch.load());
+		return pinned_version(this, reader, current.load());
+	}
+
+	// Writer thread ////////////////////////////////////////////////////////
+	// Changes go to the draft and are only seen by readers once published.
+
+	// The draft, as the writer sees it
+	version const& draft_version() const {
+		return *draft;
+	}
+
+	void add_node(x::u32 id){
+		if(draft->index->slots.has(id)){ return; }
+		own_index();
+
+		x::usize slot;
+		if(!free_slots.empty()){
+			slot = free_slots[free_slots.size() - 1];
+			free_slots.pop();
+			draft->index->ids[slot] = id;
+		}
+		else {
+			slot = draft->size();
+			grow(slot + 1);
+			draft->index->ids.append(id);
+		}
+
+		draft->index->slots.set(id, slot);
+		draft->live += 1;
+	}
+
+	void del_node(x::u32 id){
+		auto idx = draft->index_of(id);
+		if(idx < 0){ return; }
+		auto slot = x::usize(idx);
+		own_index();
+
+		// Self loops are dropped with the out edges, so the in edges
+		// left are from other nodes
+		draft->for_each_neighbor(slot, [&](x::usize to){
+			set_bit(draft->reverse_blocks, to, slot, false);
+			draft->edge_total -= 1;
+		});
+		x::usize cursor = 0;
+		for(auto from = draft->next_in_neighbor(slot, cursor); from >= 0; from = draft->next_in_neighbor(slot, cursor)){
+			set_bit(draft->blocks, from, slot, false);
+			draft->edge_total -= 1;
+		}
+		clear_row(draft->blocks, slot);
+		clear_row(draft->reverse_blocks, slot);
+
+		draft->index->ids[slot] = none;
+		draft->index->slots.del(id);
+		free_slots.append(slot);
+		draft->live -= 1;
+	}
+
+	void connect(x::u32 a, x::u32 b){
+		set_edge(a, b, true);
+	}
+
+	void disconnect(x::u32 a, x::u32 b){
+		set_edge(a, b, false);
+	}
+
+	// Make the draft hold the nodes and edges of g, node_id(slot) gives the
+	// id of a slot of g, none to skip it. Nodes and edges g lacks are
+	// removed, and only rows that differ are written to, so blocks g agrees
+	// with stay shared with the published versions.
+	template<typename Graph, typename IdFunc>
+	void load(Graph const& g, IdFunc&& node_id){
+		auto wanted = x::hash_map<x::u32, bool>(backing_allocator);
+		for(x::usize i = 0; i < g.size(); i += 1){
+			auto id = node_id(i);
+			if(id != none){ wanted.set(id, true); }
+		}
+		for(x::usize slot = 0; slot < draft->size(); slot += 1){
+			auto id = draft->node_id(slot);
+			if((id != none) && !wanted.has(id)){ del_node(id); }
+		}
+		for(x::usize i = 0; i < g.size(); i += 1){
+			auto id = node_id(i);
+			if(id != none){ add_node(id); }
+		}
+
+		// Row of g in the draft's slots, set bits that differ from it
+		auto row = x::make_slice<x::u64>(backing_allocator, draft->stride);
+		Defer(x::destroy(backing_allocator, row));
+		for(x::usize i = 0; i < g.size(); i += 1){
+			auto from = node_id(i);
+			if(from == none){ continue; }
+			auto slot = x::usize(draft->index_of(from));
+
+			x::mem_set(row.raw_data(), 0, row.size() * sizeof(x::u64));
+			g.for_each_neighbor(i, [&](x::usize j){
+				auto to = node_id(j);
+				if(to == none){ return; }
+				auto t = x::usize(draft->index_of(to));
+				row[t / 64] |= x::u64(1) << (t % 64);
+			});
+
+			auto current_row = draft->row(slot);
+			for(x::usize w = 0; w < row.size(); w += 1){
+				auto diff = current_row[w] ^ row[w];
+				while(diff != 0){
+					auto bit = x::usize(std::countr_zero(diff));
+					set_slot_edge(slot, w * 64 + bit, (row[w] >> bit) & 1);
+					diff &= diff - 1;
+				}
+			}
+		}
+	}
+
+	// Make the draft the current version, returns its number. Versions
+	// retired earlier are freed if no reader can still hold them.
+	x::u64 publish(){
+		draft->number = next_number;
+		next_number += 1;
+
+		auto old = current.exchange(draft);
+		retired.append(retired_version{old, epoch.fetch_add(1)});
+		draft = clone(*draft);
+
+		reclaim();
+		return next_number - 1;
+	}
+
+	// Free the retired versions no reader can hold anymore
+	void reclaim(){
+		auto oldest = ~x::u64(0);
+		for(auto& r : readers){
+			auto e = r.epoch.load();
+			if(e != 0){ oldest = x::min(oldest, e); }
+		}
+
+		x::usize kept = 0;
+		for(x::usize i = 0; i < retired.size(); i += 1){
+			if(retired[i].epoch < oldest){
+				release(retired[i].ptr);
+			}
+			else {
+				retired[kept] = retired[i];
+				kept += 1;
+			}
+		}
+		while(retired.size() > kept){ retired.pop(); }
+	}
+
+	// Versions published but not freed yet
+	x::usize retired_count() const {
+		return retired.size();
+	}
+
+	explicit
+	versioned_graph(x::allocator al)
+		: backing_allocator{al}, free_slots(al), retired(al)
+	{
+		auto first = x::make<version>(al);
+		first->index = new_index();
+		current.store(first);
+		draft = clone(*first);
+	}
+
+	versioned_graph(versioned_graph const&) = delete;
+	void operator=(versioned_graph const&) = delete;
+
+	// No reader may be left
+	~versioned_graph(){
+		for(auto r : retired){
+			release(r.ptr);
+		}
+		release(current.load());
+		release(draft);
+	}
+
+private:
+	struct retired_version {
+		version* ptr;
+		x::u64 epoch;
+	};
+
+	// One cache line per reader, so announcing does not slow the others
+	struct alignas(64) reader_slot {
+		// Epoch the pin started in, 0 when not reading
+		std::atomic<x::u64> epoch{0};
+		// Handed out by register_reader()
+		std::atomic<bool> in_use{false};
+	};
+
+	void unpin(x::usize reader){
+		readers[reader].epoch.store(0);
+	}
+
+	void set_edge(x::u32 a, x::u32 b, bool value){
+		auto from = draft->index_of(a);
+		auto to = draft->index_of(b);
+		if((from < 0) || (to < 0)){ return; }
+		set_slot_edge(from, to, value);
+	}
+
+	void set_slot_edge(x::usize from, x::usize to, bool value){
+		if(draft->connected(from, to) == value){ return; }
+
+		set_bit(draft->blocks, from, to, value);
+		set_bit(draft->reverse_blocks, to, from, value);
+		draft->edge_total = value ? (draft->edge_total + 1) : (draft->edge_total - 1);
+	}
+
+	void set_bit(x::slice<row_block*> blocks, x::usize r, x::usize c, bool value){
+		auto b = own_block(blocks, r / block_rows);
+		auto& w = b->words[(r % block_rows) * draft->stride + c / 64];
+		auto mask = x::u64(1) << (c % 64);
+		w = value ? (w | mask) : (w & ~mask);
+	}
+
+	void clear_row(x::slice<row_block*> blocks, x::usize r){
+		auto b = own_block(blocks, r / block_rows);
+		auto offset = (r % block_rows) * draft->stride;
+		x::mem_set(b->words.raw_data() + offset, 0, draft->stride * sizeof(x::u64));
+	}
+
+	// Block bi of the draft, copied first if a published version has it
+	row_block* own_block(x::slice<row_block*> blocks, x::usize bi){
+		auto b = blocks[bi];
+		if(b->refs == 1){ return b; }
+
+		auto copy = new_block(draft->stride);
+		x::mem_copy(copy->words.raw_data(), b->words.raw_data(), b->words.size() * sizeof(x::u64));
+		b->refs -= 1;
+		blocks[bi] = copy;
+		return copy;
+	}
+
+	node_index* new_index(){
+		auto [raw, err] = x::make_raw<node_index>(backing_allocator);
+		x::panic_assert(x::error_ok(err), "Failed to allocate node index");
+		return new (raw) node_index(backing_allocator);
+	}
+
+	void own_index(){
+		if(draft->index->refs == 1){ return; }
+
+		auto old = draft->index;
+		auto copy = new_index();
+		copy->slots.resize_capacity(old->slots.size() * 2);
+		for(x::usize slot = 0; slot < old->ids.size(); slot += 1){
+			auto id = old->ids[slot];
+			copy->ids.append(id);
+			if(id != none){ copy->slots.set(id, slot); }
+		}
+		old->refs -= 1;
+		draft->index = copy;
+	}
+
+	// Make room for n slots in the draft. Rows are widened geometrically,
+	// which copies every block, new blocks are appended one at a time.
+	void grow(x::usize n){
+		if(n > draft->stride * 64){
+			auto stride = x::max(draft->stride * 2, (n + 63) / 64);
+			widen(draft->blocks, stride);
+			widen(draft->reverse_blocks, stride);
+			draft->stride = stride;
+		}
+
+		auto needed = (n + block_rows - 1) / block_rows;
+		if(needed > draft->blocks.size()){
+			append_blocks(draft->blocks, needed);
+			append_blocks(draft->reverse_blocks, needed);
+		}
+	}
+
+	void widen(x::slice<row_block*> blocks, x::usize stride){
+		for(x::usize bi = 0; bi < blocks.size(); bi += 1){
+			auto b = blocks[bi];
+			auto wide = new_block(stride);
+			for(x::usize r = 0; r < block_rows; r += 1){
+				x::mem_copy(wide->words.raw_data() + r * stride,
+					b->words.raw_data() + r * draft->stride, draft->stride * sizeof(x::u64));
+			}
+			drop_block(b);
+			blocks[bi] = wide;
+		}
+	}
+
+	void append_blocks(x::slice<row_block*>& blocks, x::usize count){
+		auto grown = x::make_slice<row_block*>(backing_allocator, count);
+		for(x::usize bi = 0; bi < blocks.size(); bi += 1){
+			grown[bi] = blocks[bi];
+		}
+		for(x::usize bi = blocks.size(); bi < count; bi += 1){
+			grown[bi] = new_block(draft->stride);
+		}
+		x::destroy(backing_allocator, blocks);
+		blocks = grown;
+	}
+
+	row_block* new_block(x::usize stride){
+		auto b = x::make<row_block>(backing_allocator);
+		b->refs = 1;
+		b->words = x::make_slice<x::u64>(backing_allocator, block_rows * stride);
+		return b;
+	}
+
+	void drop_block(row_block* b){
+		b->refs -= 1;
+		if(b->refs > 0){ return; }
+		x::destroy(backing_allocator, b->words);
+		x::destroy(backing_allocator, b);
+	}
+
+	x::slice<row_block*> share_blocks(x::slice<row_block*> blocks){
+		auto copy = x::make_slice<row_block*>(backing_allocator, blocks.size());
+		for(x::usize bi = 0; bi < blocks.size(); bi += 1){
+			copy[bi] = blocks[bi];
+			copy[bi]->refs += 1;
+		}
+		return copy;
+	}
+
+	// Shallow copy, blocks and index are shared
+	version* clone(version const& v){
+		auto copy = x::make<version>(backing_allocator);
+		copy->stride     = v.stride;
+		copy->live       = v.live;
+		copy->edge_total = v.edge_total;
+		copy->blocks         = share_blocks(v.blocks);
+		copy->reverse_blocks = share_blocks(v.reverse_blocks);
+		copy->index = v.index;
+		copy->index->refs += 1;
+		return copy;
+	}
+
+	void release(version* v){
+		for(auto b : v->blocks){ drop_block(b); }
+		for(auto b : v->reverse_blocks){ drop_block(b); }
+		x::destroy(backing_allocator, v->blocks);
+		x::destroy(backing_allocator, v->reverse_blocks);
+		v->index->refs -= 1;
+		if(v->index->refs == 0){
+			x::destroy(backing_allocator, v->index);
+		}
+		x::destroy(backing_allocator, v);
+	}
+
+	x::allocator backing_allocator;
+	std::atomic<version*> current{nullptr};
+	version* draft = nullptr;
+	x::u64 next_number = 1;
+	// Writer only: dead slots of the draft, and replaced versions
+	x::dynamic_array<x::usize> free_slots;
+	x::dynamic_array<retired_version> retired;
+
+	std::atomic<x::u64> epoch{1};
+	reader_slot readers[max_readers];
+};
+
+#endif /* Include guard */
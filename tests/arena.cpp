@@ -0,0 +1,228 @@
+#include "testing.hpp"
+
+#include <algorithm>
+
+// Blocks of the arenas never overlap and are aligned, bump_allocator pools
+// fill up to their size, arena_allocator pools double and are reused after a
+// reset, and thread_arena_allocator does all of that with many threads
+// allocating at once. tests/run.sh also builds this test with TSan.
+
+// Heap allocator that counts the blocks it hands out and takes back
+struct counting_heap {
+	std::atomic<usize> allocs{0};
+	std::atomic<usize> frees{0};
+
+	static pair<void*, x::allocator::error> proc(
+		void* impl, x::allocator::operation op, usize size, usize align,
+		void* ptr, usize old_size, x::source_location const& caller_location)
+	{
+		auto heap = static_cast<counting_heap*>(impl);
+		if(op == x::allocator::operation::Alloc){ heap->allocs += 1; }
+		if(op == x::allocator::operation::Free){ heap->frees += 1; }
+		return x::_std_heap_alloc_proc(nullptr, op, size, align, ptr, old_size, caller_location);
+	}
+
+	x::allocator as_allocator(){
+		return x::allocator(this, proc);
+	}
+};
+
+struct block {
+	uintptr begin;
+	usize size;
+
+	bool operator<(block const& b) const {
+		return begin < b.begin;
+	}
+};
+
+// Whether no two blocks share a byte
+bool disjoint(slice<block> blocks){
+	std::sort(blocks.raw_data(), blocks.raw_data() + blocks.size());
+	for(usize i = 1; i < blocks.size(); i += 1){
+		if(blocks[i - 1].begin + blocks[i - 1].size > blocks[i].begin){ return false; }
+	}
+	return true;
+}
+
+bool aligned(void* ptr, usize align){
+	return (uintptr(ptr) % align) == 0;
+}
+
+void test_bump_allocator(){
+	alignas(64) static u8 storage[64];
+	auto bump = x::bump_allocator(slice<u8>(storage, 64));
+
+	// The whole pool can be used, not only the space left at the start
+	auto [a, err_a] = bump.alloc(48, 1);
+	auto [b, err_b] = bump.alloc(16, 1);
+	check(x::error_ok(err_a) && x::error_ok(err_b), "fills the pool");
+	check(!x::error_ok(bump.alloc(1, 1).b), "nothing past the pool");
+
+	// Resizing is bounded by the pool size, from any offset
+	bump.reset();
+	bump.alloc(8, 8);
+	auto [c, err_c] = bump.alloc(8, 8);
+	check(x::error_ok(err_c) && (uintptr(c) - uintptr(storage) == 8), "second block after the first");
+	check(x::error_ok(bump.resize(c, 56).b), "resize up to the end");
+	check(!x::error_ok(bump.resize(c, 57).b), "resize past the end");
+	check(x::error_ok(bump.resize(c, 1).b), "shrink");
+	check(bump.available_space() == 64 - 9, "space after shrinking");
+}
+
+void test_arena_allocator(test_rng& rng){
+	auto heap = counting_heap();
+	auto arena = x::arena_allocator(heap.as_allocator());
+	constexpr usize count = 2000;
+	auto blocks = make_slice<block>(default_allocator, count);
+	auto sizes = make_slice<usize>(default_allocator, count);
+	for(auto& s : sizes){ s = 1 + rng.below(200); }
+
+	for(usize round = 0; round < 3; round += 1){
+		for(usize i = 0; i < count; i += 1){
+			auto align = usize(1) << rng.below(7);
+			auto [ptr, err] = arena.alloc(sizes[i], align);
+			check(x::error_ok(err), "arena allocation");
+			check(aligned(ptr, align), "arena alignment");
+			blocks[i] = {uintptr(ptr), sizes[i]};
+		}
+		check(disjoint(blocks), "arena blocks overlap");
+
+		// Only the last pool still has room, and every pool is at least
+		// twice the size of the one before it
+		check(arena.current_pool + 1 == arena.mem_pools.size(), "allocates from the last pool");
+		for(usize i = 1; i < arena.mem_pools.size(); i += 1){
+			check(arena.mem_pools[i].size() >= 2 * arena.mem_pools[i - 1].size(), "pools double");
+		}
+		check(arena.mem_pools.size() <= 20, "logarithmic number of pools");
+
+		// The same allocations fit in the pools kept by a reset, the
+		// alignments differ so leave some slack by only taking most of them
+		auto pools = heap.allocs.load();
+		arena.reset();
+		check(arena.current_pool == 0, "reset rewinds to the first pool");
+		if(round > 0){
+			check(heap.allocs.load() == pools, "no new pools after a reset");
+		}
+		for(usize i = 0; i < count / 2; i += 1){
+			arena.alloc(sizes[i], 1);
+		}
+		check(heap.allocs.load() == pools, "reuses kept pools");
+		arena.reset();
+	}
+
+	arena.reset(x::arena_allocator::reset_mode::DeallocAll);
+	check(arena.mem_pools.size() == 0, "dealloc all drops the pools");
+}
+
+// One thread's share of the concurrent test: allocates sizes[i] bytes aligned
+// to aligns[i], checks the memory is zeroed and fills it with its own byte
+struct thread_job {
+	slice<usize> sizes;
+	slice<usize> aligns;
+	slice<block> blocks;
+	u8 fill = 0;
+	bool zeroed = true;
+	bool ok = true;
+
+	void run(x::allocator al){
+		for(usize i = 0; i < sizes.size(); i += 1){
+			auto ptr = (u8*)al.alloc(sizes[i], aligns[i]).a;
+			if((ptr == nullptr) || !aligned(ptr, aligns[i])){
+				ok = false;
+				continue;
+			}
+			for(usize b = 0; b < sizes[i]; b += 1){
+				zeroed = zeroed && (ptr[b] == 0);
+				ptr[b] = fill;
+			}
+			blocks[i] = {uintptr(ptr), sizes[i]};
+		}
+	}
+
+	// Whether no other thread wrote over the blocks
+	bool intact() const {
+		for(auto blk : blocks){
+			auto ptr = (u8 const*)blk.begin;
+			for(usize b = 0; b < blk.size; b += 1){
+				if(ptr[b] != fill){ return false; }
+			}
+		}
+		return true;
+	}
+};
+
+void test_thread_arena_allocator(test_rng& rng){
+	constexpr usize thread_count = 8;
+	constexpr usize per_thread = 1500;
+	constexpr usize chunk_size = 4096;
+
+	auto heap = counting_heap();
+	auto arena = x::thread_arena_allocator(heap.as_allocator(), chunk_size);
+
+	// Same jobs every generation, so the later ones can run on the chunks
+	// kept by the first
+	auto jobs = make_slice<thread_job>(default_allocator, thread_count);
+	usize dedicated = 0;
+	for(usize t = 0; t < thread_count; t += 1){
+		auto& job = jobs[t];
+		job.sizes = make_slice<usize>(default_allocator, per_thread);
+		job.aligns = make_slice<usize>(default_allocator, per_thread);
+		job.blocks = make_slice<block>(default_allocator, per_thread);
+		job.fill = u8(t + 1);
+		for(usize i = 0; i < per_thread; i += 1){
+			// Mostly small blocks, some larger than a whole chunk
+			job.sizes[i] = rng.chance(1, 50) ? chunk_size + rng.below(3 * chunk_size) : 1 + rng.below(300);
+			job.aligns[i] = usize(1) << rng.below(7);
+			dedicated += (job.sizes[i] + job.aligns[i] > chunk_size / 4) ? 1 : 0;
+		}
+	}
+
+	for(usize generation = 0; generation < 3; generation += 1){
+		auto before = heap.allocs.load();
+
+		auto threads = dynamic_array<std::thread>(default_allocator, thread_count + 1);
+		for(auto& job : jobs){
+			job.zeroed = true;
+			job.ok = true;
+			threads.append(std::thread([&job, &arena](){ job.run(arena.as_allocator()); }));
+		}
+		for(auto& t : threads){ t.join(); }
+
+		auto all = make_slice<block>(default_allocator, thread_count * per_thread);
+		usize n = 0;
+		for(auto const& job : jobs){
+			check(job.ok, "thread arena allocation and alignment");
+			check(job.zeroed, "thread arena memory is zeroed");
+			check(job.intact(), "thread arena blocks written by another thread");
+			for(auto blk : job.blocks){ all[n++] = blk; }
+		}
+		check(disjoint(all), "thread arena blocks overlap");
+
+		// Blocks that got a chunk of their own are freed by a reset, the
+		// standard chunks are kept and handed out again
+		if(generation > 0){
+			check(heap.allocs.load() - before == dedicated, "standard chunks reused across generations");
+		}
+
+		// The calling thread gets a fresh pool after a reset too
+		auto [first, err] = arena.alloc(64, 64);
+		check(x::error_ok(err) && aligned(first, 64), "allocation on the calling thread");
+		arena.reset();
+		auto [second, err2] = arena.alloc(64, 64);
+		check(x::error_ok(err2), "allocation after a reset");
+		check(((u8*)second)[0] == 0, "memory is zeroed after a reset");
+		arena.reset();
+	}
+
+	arena.reset(x::arena_allocator::reset_mode::DeallocAll);
+	check(heap.allocs.load() == heap.frees.load(), "dealloc all returns every chunk");
+}
+
+int main(){
+	auto rng = test_rng{25};
+	test_bump_allocator();
+	test_arena_allocator(rng);
+	test_thread_arena_allocator(rng);
+	return check_report("arena");
+}
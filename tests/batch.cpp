@@ -0,0 +1,97 @@
+#include "testing.hpp"
+
+// Batch scripts are read line by line whatever the lines hold: lines longer
+// than the read buffer stay whole, null bytes make a line fail instead of
+// ending the script, and the last line needs no line break. Graphs too big
+// for the matrix are refused by load and open, numbers too big for a u64 by
+// every command that takes one.
+
+graph_node find_node(batch_context& batch, char const* name){
+	return batch.ui.node_named(view<char>(name, x::cstr_len(name)), false);
+}
+
+// Text of a command followed by a path
+slice<char> line_of(char const* command, char const* path){
+	auto b = x::string_builder(default_allocator);
+	b.push(command);
+	b.push(path);
+	auto text = make_slice<char>(default_allocator, b.size());
+	x::mem_copy(text.raw_data(), b.build().raw_data(), b.size());
+	return text;
+}
+
+int main(){
+	auto script = std::tmpfile();
+	if(!check(script != nullptr, "temporary script")){ return check_report("batch"); }
+
+	// One node per label, more than fit in the first 4 KiB buffer
+	constexpr usize long_count = 2000;
+	std::fputs("new directed\nadd", script);
+	for(usize i = 0; i < long_count; i += 1){
+		std::fprintf(script, " n%zu", i);
+	}
+	std::fputs("\n", script);
+
+	// A null byte at the start of a line and one in the middle
+	std::fputc(0, script);
+	std::fputs("add a\n", script);
+	std::fputs("add b", script);
+	std::fputc(0, script);
+	std::fputs(" c\n", script);
+	std::fputs("add last", script);
+	std::rewind(script);
+
+	auto batch = batch_context();
+	auto errors = batch.run(script);
+	std::fclose(script);
+
+	check(errors == 2, "lines with null bytes fail");
+	check(batch.line_number == 5, "every line is read");
+	check(batch.ui.mat.node_count() == long_count + 1, "long line and last line");
+	check(batch.ui.mat.index_of(find_node(batch, "n1999")) >= 0, "end of the long line");
+	check(batch.ui.mat.index_of(find_node(batch, "last")) >= 0, "line without a break");
+	check(find_node(batch, "a").id == label_table::none, "null byte line skipped");
+
+	// One node past the limit, from an edge list and from a snapshot
+	char path[] = "/tmp/batch_XXXXXX";
+	close(mkstemp(path));
+	auto too_big = batch_context::max_loaded_nodes;
+	auto list = std::fopen(path, "wb");
+	std::fprintf(list, "0 1\n0 %zu\n", too_big);
+	std::fclose(list);
+
+	auto loader = batch_context();
+	loader.run_line(line_of("load ", path));
+	check((loader.error_count == 1) && (loader.ui.mat.node_count() == 0), "load refuses too many nodes");
+
+	auto offsets = make_slice<usize>(storage_allocator, too_big + 2);
+	auto big = csr_adjacency(storage_allocator, offsets, slice<u32>{});
+	check(write_snapshot(path, big, nullptr, {}, 0, nullptr) == snapshot_error::None, "write big snapshot");
+	auto opener = batch_context();
+	opener.run_line(line_of("open ", path));
+	check((opener.error_count == 1) && (opener.ui.mat.node_count() == 0), "open refuses too many nodes");
+
+	list = std::fopen(path, "wb");
+	std::fprintf(list, "0 %zu\n", too_big - 1);
+	std::fclose(list);
+	loader.run_line(line_of("load ", path));
+	check((loader.error_count == 1) && (loader.ui.mat.node_count() == too_big), "load up to the limit");
+
+	std::remove(path);
+
+	auto numbers = batch_context();
+	numbers.run_line(line_of("new directed ", "a b"));
+	numbers.run_line(line_of("wconnect a b ", "99999999999999999999999"));
+	numbers.run_line(line_of("wconnect a b ", "18446744073709551615"));
+	numbers.run_line(line_of("show ", "99999999999999999999 0"));
+	numbers.run_line(line_of("show ", "0 x"));
+	check(numbers.error_count == 4, "numbers too big");
+	check(!numbers.ui.mat.connected(find_node(numbers, "a"), find_node(numbers, "b")), "no edge from a bad weight");
+	numbers.run_line(line_of("wconnect a b ", "4294967295"));
+	numbers.run_line(line_of("show ", "1 1"));
+	check(numbers.error_count == 4, "largest weight and a window");
+	check(numbers.ui.mat.connected(find_node(numbers, "a"), find_node(numbers, "b")), "edge of the largest weight");
+	check((numbers.ui.window.row == 1) && (numbers.ui.window.col == 1), "window moved");
+
+	return check_report("batch");
+}
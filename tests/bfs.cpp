@@ -0,0 +1,76 @@
+#include "testing.hpp"
+
+// The direction optimizing breadth first search finds the same levels as a
+// plain top down one, sparse graphs stay top down and dense ones go bottom up.
+// The queue based search used for visiting orders matches a reference queue.
+
+template<typename Graph>
+void compare(Graph const& g, reference_graph const& ref, traversal_workspace& ws){
+	for(usize start = 0; start < ref.n; start += 1){
+		auto count = breadth_first_levels(g, start, ws);
+		auto ref_levels = ref.levels(start);
+
+		usize reached = 0;
+		for(usize v = 0; v < ref.n; v += 1){
+			check(ws.level(v) == ref_levels[v], "level");
+			reached += (ref_levels[v] >= 0) ? 1 : 0;
+		}
+		check(count == reached, "reached count");
+
+		// Every reached node once, levels never going down
+		check(ws.frontier.size() == count, "visiting order length");
+		check(ws.frontier[0] == start, "starts at start");
+		auto seen = make_slice<bool>(default_allocator, ref.n);
+		for(usize i = 0; i < ws.frontier.size(); i += 1){
+			auto v = ws.frontier[i];
+			check(!seen[v], "visited once");
+			seen[v] = true;
+			if(i > 0){
+				check(ws.level(ws.frontier[i - 1]) <= ws.level(v), "level order");
+			}
+		}
+
+		auto order = ref.visiting_order(start);
+		check(breadth_first_trail(g, start, ws) == order.size(), "queue order length");
+		for(usize i = 0; i < order.size(); i += 1){
+			check(ws.frontier[i] == order[i], "queue order");
+			check(ws.level(order[i]) == ref_levels[order[i]], "queue order level");
+		}
+
+		// Labeled searches list the order backwards, ending at start
+		auto labeled = g.breadth_first_search(g.label_index(start));
+		check(labeled.size() == order.size(), "labeled order length");
+		for(usize i = 0; i < labeled.size(); i += 1){
+			check(labeled[i] == g.label_index(order[order.size() - (i + 1)]), "labeled order");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{9};
+
+	for(usize round = 0; round < 40; round += 1){
+		auto ws = traversal_workspace(default_allocator);
+		auto n = 1 + rng.below(120);
+		// Alternate between sparse graphs and ones with half of all edges
+		auto ref = (round % 2 == 0) ? random_graph(rng, n, 1 + rng.below(4), 2 * n) : random_graph(rng, n, 1, 2);
+		auto mat = matrix_of(ref);
+		compare(mat, ref, ws);
+		compare(csr_graph(mat), ref, ws);
+
+		// Same levels whatever the thread count
+		auto one = reachability_levels(mat, 1);
+		auto many = reachability_levels(mat, 4);
+		for(usize a = 0; a < n; a += 1){
+			auto ref_levels = ref.levels(a);
+			for(usize b = 0; b < n; b += 1){
+				check(one[a][b] == ref_levels[b], "levels on one thread");
+				check(many[a][b] == ref_levels[b], "levels on four threads");
+			}
+		}
+
+		arena.reset();
+	}
+
+	return check_report("bfs");
+}
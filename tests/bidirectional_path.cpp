@@ -0,0 +1,47 @@
+#include "testing.hpp"
+
+// Bidirectional paths are shortest paths: they walk real edges and are as long
+// as the breadth first distance, and they exist exactly when one does.
+
+template<typename Graph>
+void compare(Graph const& g, reference_graph const& ref, traversal_workspace& ws){
+	for(usize a = 0; a < ref.n; a += 1){
+		auto ref_levels = ref.levels(a);
+		for(usize b = 0; b < ref.n; b += 1){
+			auto path = find_path_into(g, a, b, path_mode::Bidirectional, ws);
+			if(ref_levels[b] < 0){
+				check(path.size() == 0, "no path when unreachable");
+				continue;
+			}
+			check(ref.valid_path(path, a, b), "path walks edges");
+			check(path.size() == usize(ref_levels[b]) + 1, "shortest length");
+
+			auto bfs_path = find_path_into(g, a, b, path_mode::BreadthFirst, ws);
+			check(bfs_path.size() == usize(ref_levels[b]) + 1, "breadth first length");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{11};
+
+	for(usize round = 0; round < 40; round += 1){
+		auto ws = traversal_workspace(default_allocator);
+		auto n = 1 + rng.below(60);
+		auto ref = random_graph(rng, n, 1 + rng.below(4), 2 * n);
+		auto mat = matrix_of(ref);
+		compare(mat, ref, ws);
+		compare(csr_graph(mat), ref, ws);
+
+		// Long chains, where the two frontiers stay small and meet midway
+		auto chain = reference_graph(n);
+		for(usize i = 0; i + 1 < n; i += 1){
+			chain.set_edge(i, i + 1, 1);
+		}
+		compare(matrix_of(chain), chain, ws);
+
+		arena.reset();
+	}
+
+	return check_report("bidirectional_path");
+}
@@ -0,0 +1,115 @@
+#include "testing.hpp"
+
+// The word parallel transitive closure agrees with a breadth first search
+// from every node, before and after the graph changes. So does the tracked
+// closure while nodes are deleted, added back and compacted away.
+
+void compare(connectivity_matrix const& mat, reference_graph const& ref){
+	auto n = ref.n;
+
+	auto bits = reachability_bits(mat);
+	auto bmat = mat.reachability_matrix_bool();
+	auto levels = mat.reachability_matrix();
+	check(bits.size() == n, "bit matrix size");
+	check(bmat.size() == n, "bool matrix size");
+
+	for(usize a = 0; a < n; a += 1){
+		auto ref_levels = ref.levels(a);
+		for(usize b = 0; b < n; b += 1){
+			auto reaches = (a != b) && (ref_levels[b] >= 0);
+			check(bits.get(a, b) == reaches, "bit matrix");
+			check(bmat[a][b] == reaches, "bool matrix");
+			check(levels[a][b] == ref_levels[b], "levels");
+			check(mat.reachable(graph_node{u32(a)}, graph_node{u32(b)}) == (ref_levels[b] >= 0), "reachable");
+		}
+	}
+}
+
+// Only the nodes still in the graph, through their labels. Deleted nodes
+// have no edges left in ref.
+void compare_tracked(connectivity_matrix const& mat, reference_graph const& ref, slice<bool> present){
+	check(mat.closure.enabled(), "still tracking");
+	auto live = mat.live_nodes();
+	auto bmat = mat.reachability_matrix_bool();
+	check(bmat.size() == live.size(), "bool matrix of the live nodes");
+
+	for(usize i = 0; i < live.size(); i += 1){
+		auto a = live[i].id;
+		check(present[a], "live node");
+		auto ref_levels = ref.levels(a);
+		for(usize j = 0; j < live.size(); j += 1){
+			auto b = live[j].id;
+			check(bmat[i][j] == ((a != b) && (ref_levels[b] >= 0)), "tracked bool matrix");
+			check(mat.reachable(live[i], live[j]) == (ref_levels[b] >= 0), "tracked reachable");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{7};
+
+	for(usize round = 0; round < 30; round += 1){
+		// Sizes around and past a multiple of 64 bits, sparse to dense
+		auto n = 1 + rng.below(150);
+		auto density = 1 + rng.below(8);
+		auto ref = random_graph(rng, n, density, 4 * n);
+		auto mat = matrix_of(ref);
+		compare(mat, ref);
+
+		// The tracked closure follows edges being added and removed
+		mat.track_reachability();
+		for(usize i = 0; i < 2 * n; i += 1){
+			auto a = rng.below(n);
+			auto b = rng.below(n);
+			auto add = rng.chance(1, 2);
+			if(add){ mat.connect(graph_node{u32(a)}, graph_node{u32(b)}); }
+			else { mat.disconnect(graph_node{u32(a)}, graph_node{u32(b)}); }
+			ref.set_edge(a, b, add ? 1 : 0);
+		}
+		compare(mat, ref);
+
+		arena.reset();
+	}
+
+	usize compactions = 0;
+	for(usize round = 0; round < 30; round += 1){
+		auto n = 1 + rng.below(40);
+		auto ref = random_graph(rng, n, 1 + rng.below(4), 2 * n);
+		auto mat = matrix_of(ref);
+		mat.track_reachability();
+		auto present = make_slice<bool>(default_allocator, n);
+		for(auto& p : present){ p = true; }
+
+		for(usize i = 0; i < 3 * n; i += 1){
+			auto a = rng.below(n);
+			auto b = rng.below(n);
+			auto op = rng.below(4);
+			if((op == 0) && present[a]){
+				auto slots = mat.size();
+				mat.del_node(graph_node{u32(a)});
+				compactions += (mat.size() < slots) ? 1 : 0;
+				for(usize v = 0; v < n; v += 1){
+					ref.set_edge(a, v, 0);
+					ref.set_edge(v, a, 0);
+				}
+				present[a] = false;
+			}
+			else if((op == 1) && !present[a]){
+				mat.add_node(graph_node{u32(a)});
+				present[a] = true;
+			}
+			else if(present[a] && present[b]){
+				auto add = rng.chance(2, 3);
+				if(add){ mat.connect(graph_node{u32(a)}, graph_node{u32(b)}); }
+				else { mat.disconnect(graph_node{u32(a)}, graph_node{u32(b)}); }
+				ref.set_edge(a, b, add ? 1 : 0);
+			}
+			compare_tracked(mat, ref, present);
+		}
+
+		arena.reset();
+	}
+	check(compactions > 0, "deletions compacted the matrix");
+
+	return check_report("closure");
+}
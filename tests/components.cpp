@@ -0,0 +1,88 @@
+#include "testing.hpp"
+
+// Two nodes share a strongly connected component exactly when each reaches
+// the other, component ids are in reverse topological order and the labeled
+// subgraphs hold the same groups.
+
+// Whether a and b reach each other
+slice<slice<bool>> mutual_reach(reference_graph const& ref){
+	auto reach = make_slice<slice<i32>>(default_allocator, ref.n);
+	for(usize a = 0; a < ref.n; a += 1){ reach[a] = ref.levels(a); }
+
+	auto mutual = make_slice<slice<bool>>(default_allocator, ref.n);
+	for(usize a = 0; a < ref.n; a += 1){
+		mutual[a] = make_slice<bool>(default_allocator, ref.n);
+		for(usize b = 0; b < ref.n; b += 1){
+			mutual[a][b] = (reach[a][b] >= 0) && (reach[b][a] >= 0);
+		}
+	}
+	return mutual;
+}
+
+template<typename Graph>
+void compare(Graph const& g, reference_graph const& ref, slice<slice<bool>> mutual){
+	auto n = ref.n;
+	auto [comp, comp_count] = tarjan_components(g);
+	check(comp.size() == n, "component per node");
+
+	usize groups = 0;
+	for(usize a = 0; a < n; a += 1){
+		check(comp[a] < comp_count, "component id");
+		// a is the first node of its group when no earlier node reaches
+		// it both ways
+		bool first = true;
+		for(usize b = 0; b < n; b += 1){
+			check((comp[a] == comp[b]) == mutual[a][b], "same component");
+			if((b < a) && mutual[a][b]){ first = false; }
+			if(ref.has_edge(a, b) && (comp[a] != comp[b])){
+				check(comp[a] > comp[b], "reverse topological order");
+			}
+		}
+		groups += first ? 1 : 0;
+	}
+	check(comp_count == groups, "component count");
+
+	// Groups ordered by their smallest node, each in ascending order
+	auto components = strongly_connected_components(g);
+	check(components.size() == groups, "group count");
+	usize last_first = 0;
+	for(usize i = 0; i < components.size(); i += 1){
+		auto group = components[i];
+		check((i == 0) || (group[0] > last_first), "groups by smallest node");
+		last_first = group[0];
+		for(usize j = 0; j < group.size(); j += 1){
+			check((j == 0) || (group[j - 1] < group[j]), "ascending group");
+			check(mutual[group[0]][group[j]], "group members reach each other");
+		}
+	}
+
+	// Labeled subgraphs list the same groups, highest slot first
+	auto subgraphs = g.strongly_connected_subgraphs();
+	check(subgraphs.size() == groups, "subgraph count");
+	for(usize i = 0; i < x::min(subgraphs.size(), components.size()); i += 1){
+		auto sub = subgraphs[i];
+		auto group = components[i];
+		check(sub.size() == group.size(), "subgraph size");
+		for(usize j = 0; j < x::min(sub.size(), group.size()); j += 1){
+			check(sub[j] == g.label_index(group[group.size() - (j + 1)]), "subgraph members");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{6};
+
+	for(usize round = 0; round < 60; round += 1){
+		// Sparse graphs have many small components, denser ones a few big
+		auto n = 1 + rng.below(60);
+		auto ref = random_graph(rng, n, 1 + rng.below(6), 3 * n);
+		auto mutual = mutual_reach(ref);
+		auto mat = matrix_of(ref);
+		compare(mat, ref, mutual);
+		compare(csr_graph(mat), ref, mutual);
+
+		arena.reset();
+	}
+
+	return check_report("components");
+}
@@ -0,0 +1,74 @@
+#include "testing.hpp"
+
+// The same queries on a connectivity_matrix and on a csr_graph of the same
+// graph give the same answers, in the same order.
+
+template<typename T>
+bool same_nodes(slice<T> a, slice<T> b){
+	if(a.size() != b.size()){ return false; }
+	for(usize i = 0; i < a.size(); i += 1){
+		if(!(a[i] == b[i])){ return false; }
+	}
+	return true;
+}
+
+template<typename T>
+bool same_pairs(slice<pair<graph_node, T>> a, slice<pair<graph_node, T>> b){
+	if(a.size() != b.size()){ return false; }
+	for(usize i = 0; i < a.size(); i += 1){
+		if((a[i].a != b[i].a) || (a[i].b != b[i].b)){ return false; }
+	}
+	return true;
+}
+
+template<typename Graph>
+void compare(connectivity_matrix const& mat, Graph const& csr){
+	auto nodes = mat.live_nodes();
+	check(csr.size() == nodes.size(), "node count");
+	check(csr.edge_count() == mat.edge_count(), "edge count");
+
+	auto mat_scc = mat.strongly_connected_subgraphs();
+	auto csr_scc = csr.strongly_connected_subgraphs();
+	check(mat_scc.size() == csr_scc.size(), "component count");
+	for(usize i = 0; i < x::min(mat_scc.size(), csr_scc.size()); i += 1){
+		check(same_nodes(mat_scc[i], csr_scc[i]), "components in the same order");
+	}
+
+	for(auto a : nodes){
+		check(same_nodes(mat.breadth_first_search(a), csr.breadth_first_search(a)), "bfs order");
+		check(same_nodes(mat.depth_first_search(a), csr.depth_first_search(a)), "dfs order");
+		check(same_pairs(mat.transitive_closure(a), csr.transitive_closure(a)), "closure");
+		check(same_pairs(mat.shortest_distances(a), csr.shortest_distances(a)), "distances");
+		for(auto b : nodes){
+			check(mat.reachable(a, b) == csr.reachable(a, b), "reachable");
+			for(auto mode : {path_mode::DepthFirst, path_mode::BreadthFirst, path_mode::Bidirectional}){
+				check(same_nodes(mat.find_path(a, b, mode), csr.find_path(a, b, mode)), "path");
+			}
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{2};
+
+	for(usize round = 0; round < 40; round += 1){
+		auto n = 1 + rng.below(40);
+		auto density = 1 + rng.below(4);
+
+		// From a node list and edges, which carry no weights
+		auto unweighted = matrix_of(random_graph(rng, n, density, 2 * n));
+		compare(unweighted, csr_graph(unweighted.live_nodes(), unweighted.edges()));
+
+		// From a weighted matrix, with some of its nodes deleted
+		auto mat = matrix_of(random_graph(rng, n, density, 2 * n, 9));
+		compare(mat, csr_graph(mat));
+		for(usize i = 0; i < n / 4; i += 1){
+			mat.del_node(graph_node{u32(rng.below(n))});
+		}
+		compare(mat, csr_graph(mat));
+
+		arena.reset();
+	}
+
+	return check_report("csr_graph");
+}
@@ -0,0 +1,123 @@
+#include "testing.hpp"
+
+// The depth first search on (node, cursor) frames enters and leaves nodes in
+// the same order as a recursive one taking neighbours in ascending order, and
+// the reverse of its finish order is a topological order of acyclic graphs.
+
+struct reference_dfs {
+	reference_graph const& ref;
+	slice<bool> seen;
+	dynamic_array<usize> pre;
+	dynamic_array<usize> post;
+	slice<bool> active;
+	bool cycle = false;
+
+	void visit(usize u){
+		seen[u] = true;
+		active[u] = true;
+		pre.append(u);
+		for(usize v = 0; v < ref.n; v += 1){
+			if(!ref.has_edge(u, v)){ continue; }
+			if(!seen[v]){ visit(v); }
+			else if(active[v]){ cycle = true; }
+		}
+		active[u] = false;
+		post.append(u);
+	}
+
+	reference_dfs(reference_graph const& ref)
+		: ref{ref},
+		seen{make_slice<bool>(default_allocator, ref.n)},
+		pre{default_allocator},
+		post{default_allocator},
+		active{make_slice<bool>(default_allocator, ref.n)} {}
+};
+
+template<typename Graph>
+void compare(Graph const& g, reference_graph const& ref, traversal_workspace& ws){
+	for(usize start = 0; start < ref.n; start += 1){
+		auto dfs = reference_dfs(ref);
+		dfs.visit(start);
+		auto count = depth_first_trail(g, start, ws);
+		check(count == dfs.pre.size(), "trail length");
+		for(usize i = 0; i < count; i += 1){
+			check(ws.frontier[i] == dfs.pre[i], "trail pre-order");
+			check(ws.finish_order[i] == dfs.post[i], "trail post-order");
+		}
+
+		// Labeled searches list the pre-order backwards, ending at start
+		auto labeled = g.depth_first_search(g.label_index(start));
+		check(labeled.size() == dfs.pre.size(), "labeled order length");
+		for(usize i = 0; i < labeled.size(); i += 1){
+			check(labeled[i] == g.label_index(dfs.pre[dfs.pre.size() - (i + 1)]), "labeled order");
+		}
+	}
+
+	auto dfs = reference_dfs(ref);
+	for(usize v = 0; v < ref.n; v += 1){
+		if(!dfs.seen[v]){ dfs.visit(v); }
+	}
+	auto cycle = depth_first_forest(g, ws);
+	check(cycle == dfs.cycle, "cycle");
+	check(ws.frontier.size() == ref.n, "forest covers every node");
+	for(usize i = 0; i < ref.n; i += 1){
+		check(ws.frontier[i] == dfs.pre[i], "forest pre-order");
+		check(ws.finish_order[i] == dfs.post[i], "forest post-order");
+	}
+}
+
+// Whether order lists every node once with every edge pointing forward
+bool topological(reference_graph const& ref, slice<graph_node> order){
+	if(order.size() != ref.n){ return false; }
+	auto position = make_slice<usize>(default_allocator, ref.n);
+	auto seen = make_slice<bool>(default_allocator, ref.n);
+	for(usize i = 0; i < order.size(); i += 1){
+		if(seen[order[i].id]){ return false; }
+		seen[order[i].id] = true;
+		position[order[i].id] = i;
+	}
+	for(usize a = 0; a < ref.n; a += 1){
+		for(usize b = 0; b < ref.n; b += 1){
+			if(ref.has_edge(a, b) && (position[a] >= position[b])){ return false; }
+		}
+	}
+	return true;
+}
+
+int main(){
+	auto rng = test_rng{13};
+
+	for(usize round = 0; round < 60; round += 1){
+		auto ws = traversal_workspace(default_allocator);
+		auto n = 1 + rng.below(80);
+		auto ref = random_graph(rng, n, 1 + rng.below(3), 2 * n);
+		// Every other graph only keeps its forward edges, so it is acyclic
+		if(round % 2 == 0){
+			for(usize a = 0; a < n; a += 1){
+				for(usize b = 0; b <= a; b += 1){ ref.set_edge(a, b, 0); }
+			}
+		}
+
+		auto mat = matrix_of(ref);
+		compare(mat, ref, ws);
+		auto csr = csr_graph(mat);
+		compare(csr, ref, ws);
+
+		auto dfs = reference_dfs(ref);
+		for(usize v = 0; v < n; v += 1){
+			if(!dfs.seen[v]){ dfs.visit(v); }
+		}
+		if(dfs.cycle){
+			check(mat.topological_order().size() == 0, "no order with a cycle");
+			check(csr.topological_order().size() == 0, "no csr order with a cycle");
+		}
+		else {
+			check(topological(ref, mat.topological_order()), "topological order");
+			check(topological(ref, csr.topological_order()), "csr topological order");
+		}
+
+		arena.reset();
+	}
+
+	return check_report("dfs");
+}
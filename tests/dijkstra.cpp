@@ -0,0 +1,84 @@
+#include "testing.hpp"
+
+// Dijkstra over the radix heap finds the same distances as the O(V^2) version
+// without a heap, and the heap pops keys in the order a sorted list would.
+
+void check_heap(test_rng& rng){
+	auto heap = radix_heap<u32>(default_allocator);
+	// Pending entries, unsorted, the smallest is searched for on every pop
+	auto pending = dynamic_array<pair<u64, u32>>(default_allocator);
+	u32 next_value = 0;
+
+	for(usize i = 0; i < 5000; i += 1){
+		if(pending.empty() || rng.chance(3, 5)){
+			// Keys never go below the last popped one, small steps and huge
+			// ones so every bucket gets used
+			auto step = rng.chance(1, 2) ? u64(rng.below(20)) : (rng.next() >> rng.below(64));
+			auto key = heap.last_key() + x::min(step, ~u64(0) - heap.last_key());
+			heap.push(key, next_value);
+			pending.append({key, next_value});
+			next_value += 1;
+		}
+		else {
+			usize smallest = 0;
+			for(usize k = 1; k < pending.size(); k += 1){
+				if(pending[k].a < pending[smallest].a){ smallest = k; }
+			}
+			auto e = heap.pop();
+			check(e.key == pending[smallest].a, "smallest key first");
+
+			// Any entry with that key may come out, it must be a pending one
+			isize found = -1;
+			for(usize k = 0; k < pending.size(); k += 1){
+				if((pending[k].a == e.key) && (pending[k].b == e.value)){ found = isize(k); }
+			}
+			check(found >= 0, "popped a pushed entry");
+			if(found >= 0){
+				pending[usize(found)] = pending[pending.size() - 1];
+				pending.pop();
+			}
+		}
+		check(heap.size() == pending.size(), "size");
+	}
+}
+
+template<typename Graph>
+void compare(Graph const& g, reference_graph const& ref){
+	for(usize start = 0; start < ref.n; start += 1){
+		auto dist = shortest_distances(g, start);
+		auto expected = ref.distances(start);
+		for(usize v = 0; v < ref.n; v += 1){
+			check(dist[v] == expected[v], "distance");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{20};
+
+	for(usize round = 0; round < 40; round += 1){
+		check_heap(rng);
+
+		// Small weights with many ties, then weights up to the u32 limit
+		auto n = 1 + rng.below(60);
+		auto max_weight = (round % 2 == 0) ? u32(9) : ~u32(0);
+		auto ref = random_graph(rng, n, 1 + rng.below(4), 2 * n, max_weight);
+		auto mat = matrix_of(ref);
+		compare(mat, ref);
+		compare(csr_graph(mat), ref);
+
+		// Labeled results follow live_nodes(), node i has id i
+		for(usize start = 0; start < n; start += 1){
+			auto labeled = mat.shortest_distances(graph_node{u32(start)});
+			auto expected = ref.distances(start);
+			check(labeled.size() == n, "labeled size");
+			for(usize v = 0; v < x::min(n, labeled.size()); v += 1){
+				check((labeled[v].a == graph_node{u32(v)}) && (labeled[v].b == expected[v]), "labeled distance");
+			}
+		}
+
+		arena.reset();
+	}
+
+	return check_report("dijkstra");
+}
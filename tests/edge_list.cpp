@@ -0,0 +1,126 @@
+#include "testing.hpp"
+
+// Edge lists parse to the same graph whatever the thread count, including
+// texts shorter than the number of chunks and a last line without '\n'.
+
+// Copy of text in a buffer of exactly its size, so reading out of it is caught
+// by the sanitizers
+slice<char> exact_copy(x::string_builder const& text){
+	auto copy = make_slice<char>(default_allocator, text.size());
+	x::mem_copy(copy.raw_data(), text.build().raw_data(), text.size());
+	return copy;
+}
+
+edge_list_error parse(csr_adjacency& out, view<char> text, usize thread_count, usize max_nodes = edge_list_max_nodes){
+	return parse_edge_list(out, text, storage_allocator, thread_count, max_nodes);
+}
+
+void check_graph(csr_adjacency const& adj, reference_graph const& ref, usize node_count){
+	check(adj.size() == node_count, "node count");
+	if(adj.size() != node_count){ return; }
+	check(adj.edge_count() == ref.edge_count(), "edge count");
+	for(usize a = 0; a < node_count; a += 1){
+		for(usize b = 0; b < node_count; b += 1){
+			check(adj.has_edge(a, b) == ref.has_edge(a, b), "edges");
+		}
+	}
+}
+
+void check_text(char const* text, usize node_count, std::initializer_list<pair<u32, u32>> edges){
+	auto ref = reference_graph(node_count);
+	for(auto [a, b] : edges){ ref.set_edge(a, b, 1); }
+
+	auto builder = x::string_builder(default_allocator);
+	builder.push(text);
+	auto copy = exact_copy(builder);
+	for(usize threads = 1; threads <= 16; threads += 1){
+		auto adj = csr_adjacency(storage_allocator);
+		check(parse(adj, copy, threads) == edge_list_error::None, "parses");
+		check_graph(adj, ref, node_count);
+	}
+}
+
+void check_error(char const* text, edge_list_error expected, usize max_nodes = edge_list_max_nodes){
+	auto builder = x::string_builder(default_allocator);
+	builder.push(text);
+	auto copy = exact_copy(builder);
+	for(usize threads = 1; threads <= 4; threads += 1){
+		auto adj = csr_adjacency(storage_allocator);
+		check(parse(adj, copy, threads, max_nodes) == expected, "error");
+	}
+}
+
+int main(){
+	// Empty and tiny texts, with more threads than bytes
+	check_text("", 0, {});
+	check_text("\n", 0, {});
+	check_text("# only a comment", 0, {});
+	check_text("0 1", 2, {{0, 1}});
+	check_text("0 1\n", 2, {{0, 1}});
+	check_text("2\t0\r\n% x\n\n1 1 extra", 3, {{2, 0}, {1, 1}});
+	check_text("0 1\n0 1\n1 0", 2, {{0, 1}, {1, 0}});
+
+	check_error("0", edge_list_error::BadFormat);
+	check_error("0 1\nx 2\n", edge_list_error::BadFormat);
+	check_error("0 99999999999", edge_list_error::TooManyNodes);
+
+	// Ids past a given limit fail before anything is sized after them, a
+	// source or destination this large would take gigabytes otherwise
+	check_error("0 1\n0 5", edge_list_error::TooManyNodes, 5);
+	check_error("0 1\n0 5", edge_list_error::None, 6);
+	check_error("0 4000000000", edge_list_error::TooManyNodes, 1000);
+	check_error("4000000000 0", edge_list_error::TooManyNodes, 1000);
+	check_error("0 0", edge_list_error::TooManyNodes, 0);
+
+	// Random lists, with or without a newline at the end
+	auto rng = test_rng{15};
+	for(usize round = 0; round < 100; round += 1){
+		auto n = 1 + rng.below(50);
+		auto ref = random_graph(rng, n, 1 + rng.below(3), n);
+		auto text = x::string_builder(default_allocator);
+		usize max_id = 0;
+		bool any = false;
+		for(usize a = 0; a < n; a += 1){
+			for(usize b = 0; b < n; b += 1){
+				if(!ref.has_edge(a, b)){ continue; }
+				if(rng.chance(1, 10)){ text.push("# comment\n"); }
+				text.push_integer(i64(a));
+				text.push(rng.chance(1, 2) ? " " : " \t ");
+				text.push_integer(i64(b));
+				text.push(byte('\n'));
+				max_id = x::max(max_id, a, b);
+				any = true;
+			}
+		}
+		auto size = text.size();
+		if((size > 0) && rng.chance(1, 2)){ size -= 1; }
+
+		auto copy = exact_copy(text).sub(0, size);
+		for(usize threads = 1; threads <= 8; threads += 1){
+			auto adj = csr_adjacency(storage_allocator);
+			check(parse(adj, copy, threads) == edge_list_error::None, "parses");
+			check_graph(adj, ref, any ? max_id + 1 : 0);
+		}
+		arena.reset();
+	}
+
+	// From files
+	auto adj = csr_adjacency(storage_allocator);
+	check(load_edge_list(adj, "/nonexistent/edges.txt", storage_allocator) == edge_list_error::OpenFailed, "missing file");
+
+	char path[] = "/tmp/edge_list_XXXXXX";
+	auto fd = mkstemp(path);
+	check(fd >= 0, "temporary file");
+	close(fd);
+	check(load_edge_list(adj, path, storage_allocator) == edge_list_error::None, "empty file");
+	check(adj.size() == 0, "empty file has no nodes");
+
+	auto file = std::fopen(path, "w");
+	std::fputs("3 1\n1 3", file);
+	std::fclose(file);
+	check(load_edge_list(adj, path, storage_allocator, 8) == edge_list_error::None, "tiny file");
+	check((adj.size() == 4) && adj.has_edge(3, 1) && adj.has_edge(1, 3) && (adj.edge_count() == 2), "tiny file edges");
+	std::remove(path);
+
+	return check_report("edge_list");
+}
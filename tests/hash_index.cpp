@@ -0,0 +1,86 @@
+#include "testing.hpp"
+
+// x::hash_map against a plain array indexed by key, and the label index of
+// connectivity_matrix against a linear search of its slots.
+
+void test_hash_map(test_rng& rng){
+	constexpr usize key_range = 512;
+	auto map = hash_map<u64, u64>(default_allocator);
+	auto values = make_slice<u64>(default_allocator, key_range);
+	auto present = make_slice<bool>(default_allocator, key_range);
+	usize count = 0;
+
+	for(usize op = 0; op < 200000; op += 1){
+		// Keys far apart in value but close in the range, to collide
+		auto k = rng.below(key_range);
+		auto key = u64(k) * 0x10000;
+		auto r = rng.below(10);
+
+		if(r < 5){
+			auto v = rng.next();
+			check(map.set(key, v), "set succeeds");
+			if(!present[k]){ count += 1; }
+			present[k] = true;
+			values[k] = v;
+		}
+		else if(r < 8){
+			check(map.del(key) == present[k], "del finds exactly the present keys");
+			if(present[k]){ count -= 1; }
+			present[k] = false;
+		}
+		else {
+			auto [v, ok] = map.get(key);
+			check(ok == present[k], "get finds exactly the present keys");
+			check(!ok || (v == values[k]), "get returns the last value set");
+			check(map.has(key) == present[k], "has");
+		}
+		check(map.size() == count, "size");
+
+		if(op % 50000 == 49999){
+			map.clear();
+			for(auto& p : present){ p = false; }
+			count = 0;
+			check(map.empty(), "empty after clear");
+		}
+	}
+}
+
+// Every live node is found at its slot, deleted ones are not found
+void check_index(connectivity_matrix const& mat, view<bool> added, u32 id_range){
+	for(u32 id = 0; id < id_range; id += 1){
+		isize slot = -1;
+		for(usize i = 0; i < mat.size(); i += 1){
+			if(mat.alive(i) && (mat.node_map[i] == graph_node{id})){ slot = isize(i); }
+		}
+		check(mat.index_of(graph_node{id}) == slot, "index_of agrees with a linear search");
+		check((slot >= 0) == added[id], "live nodes are the added ones");
+	}
+}
+
+void test_matrix_index(test_rng& rng){
+	constexpr u32 id_range = 300;
+	auto mat = connectivity_matrix(slice<graph_node>{});
+	auto added = make_slice<bool>(default_allocator, id_range);
+
+	for(usize op = 0; op < 4000; op += 1){
+		auto id = u32(rng.below(id_range));
+		if(rng.chance(3, 5)){
+			mat.add_node(graph_node{id});
+			added[id] = true;
+		}
+		else {
+			// Enough deletions to compact now and then
+			mat.del_node(graph_node{id});
+			added[id] = false;
+		}
+		if(op % 97 == 0){ check_index(mat, added, id_range); }
+	}
+	check_index(mat, added, id_range);
+}
+
+int main(){
+	auto rng = test_rng{3};
+	test_hash_map(rng);
+	test_matrix_index(rng);
+	return check_report("hash_index");
+}
@@ -0,0 +1,79 @@
+#include "testing.hpp"
+
+// label_table hands out the same ids as a linear search through the labels
+// seen so far, and keeps its own copy of every name.
+
+bool same_text(x::string a, view<char> b){
+	if(a.size() != b.size()){ return false; }
+	for(usize i = 0; i < b.size(); i += 1){
+		if(char(a.raw_data()[i]) != b[i]){ return false; }
+	}
+	return true;
+}
+
+// Index of text among the known labels, -1 if it is new
+isize linear_find(dynamic_array<slice<char>> const& known, view<char> text){
+	for(usize i = 0; i < known.size(); i += 1){
+		if(known[i].size() != text.size()){ continue; }
+		bool equal = true;
+		for(usize k = 0; k < text.size(); k += 1){
+			equal = equal && (known[i][k] == text[k]);
+		}
+		if(equal){ return isize(i); }
+	}
+	return -1;
+}
+
+int main(){
+	auto rng = test_rng{19};
+
+	for(usize round = 0; round < 20; round += 1){
+		auto table = label_table(storage_allocator);
+		auto known = dynamic_array<slice<char>>(default_allocator);
+		// Reused for every label, so the table must not keep pointers into it
+		auto buf = make_slice<char>(default_allocator, 3 * label_table::chunk_size);
+
+		for(usize i = 0; i < 3000; i += 1){
+			// Mostly short labels from a small alphabet, so many repeat, some
+			// empty and a few longer than a whole chunk
+			auto length = 1 + rng.below(4);
+			if(rng.chance(1, 100)){ length = 0; }
+			if(rng.chance(1, 500)){ length = label_table::chunk_size + rng.below(label_table::chunk_size); }
+			for(usize k = 0; k < length; k += 1){
+				buf[k] = char('a' + rng.below(4));
+			}
+			auto text = view<char>(buf.raw_data(), length);
+
+			auto expected = linear_find(known, text);
+			if(rng.chance(1, 4)){
+				auto id = table.find(string(text));
+				check((expected < 0) ? (id == label_table::none) : (id == u32(expected)), "find");
+				continue;
+			}
+
+			auto id = table.intern(string(text));
+			if(expected < 0){
+				check(id == known.size(), "new labels get the next id");
+				auto copy = make_slice<char>(default_allocator, length);
+				for(usize k = 0; k < length; k += 1){ copy[k] = text[k]; }
+				known.append(copy);
+			}
+			else {
+				check(id == u32(expected), "known labels keep their id");
+			}
+			x::mem_set(buf.raw_data(), 0, length);
+		}
+
+		// Names survive the table being moved
+		auto moved = x::move(table);
+		check(moved.size() == known.size(), "size");
+		for(usize i = 0; i < known.size(); i += 1){
+			check(same_text(moved.name(u32(i)), known[i]), "name");
+			check(moved.find(string(view<char>(known[i]))) == u32(i), "find after move");
+		}
+
+		arena.reset();
+	}
+
+	return check_report("label_table");
+}
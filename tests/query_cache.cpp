@@ -0,0 +1,159 @@
+#include "testing.hpp"
+
+// Cached query results are handed out as copies: writing to one does not reach
+// the cache, and they stay readable after the cache evicts or clears the entry
+// they came from. After a change the queries give the values of the changed
+// graph. Run under AddressSanitizer to catch reads of freed entries.
+
+template<typename T>
+bool same(view<T> a, view<T> b){
+	if(a.size() != b.size()){ return false; }
+	for(usize i = 0; i < a.size(); i += 1){
+		if(!(a[i] == b[i])){ return false; }
+	}
+	return true;
+}
+
+bool same(view<pair<graph_node, i32>> a, view<pair<graph_node, i32>> b){
+	if(a.size() != b.size()){ return false; }
+	for(usize i = 0; i < a.size(); i += 1){
+		if((a[i].a != b[i].a) || (a[i].b != b[i].b)){ return false; }
+	}
+	return true;
+}
+
+// Whether a closure lists every node of ref in order with its level from start
+bool matches(slice<pair<graph_node, i32>> closure, reference_graph const& ref, usize start){
+	auto levels = ref.levels(start);
+	if(closure.size() != ref.n){ return false; }
+	for(usize i = 0; i < ref.n; i += 1){
+		if((closure[i].a.id != i) || (closure[i].b != levels[i])){ return false; }
+	}
+	return true;
+}
+
+void check_lru(){
+	// Room for two entries of 4 values
+	auto cache = lru_cache<u32, u64>(storage_allocator, 8 * sizeof(u64));
+	u64 first[4] = {1, 2, 3, 4};
+	check(cache.put(1, view<u64>(first, 4)), "put");
+
+	auto [a, hit] = cache.get(1, default_allocator);
+	check(hit && same(view(a), view<u64>(first, 4)), "hit");
+	a[0] = 99;
+	auto [b, hit_again] = cache.get(1, default_allocator);
+	check(hit_again && (b[0] == 1), "writes to a result stay out of the cache");
+
+	// Pushing entry 1 out keeps the copies handed out before
+	u64 other[4] = {5, 6, 7, 8};
+	check(cache.put(2, view<u64>(other, 4)), "put second");
+	check(cache.put(3, view<u64>(other, 4)), "put third");
+	check(!cache.get(1, default_allocator).b, "evicted");
+	check((b[0] == 1) && (b[3] == 4), "copy outlives eviction");
+
+	cache.clear();
+	check(!cache.get(2, default_allocator).b, "cleared");
+	check(cache.bytes_used() == 0, "nothing used after clear");
+
+	// Too large for the whole budget
+	u64 big[9] = {};
+	check(!cache.put(4, view<u64>(big, 9)), "larger than the budget");
+}
+
+void check_rows(){
+	auto cache = cached_rows<i32>(storage_allocator);
+	check(!cache.get(default_allocator).b, "empty");
+
+	auto src = make_slice<slice<i32>>(default_allocator, 3);
+	for(usize i = 0; i < src.size(); i += 1){
+		src[i] = make_slice<i32>(default_allocator, i + 1);
+		for(auto& v : src[i]){ v = i32(i); }
+	}
+	cache.put(src);
+
+	auto [a, hit] = cache.get(default_allocator);
+	check(hit && (a.size() == 3) && (a[2].size() == 3), "hit");
+	a[2][0] = -5;
+	auto [b, hit_again] = cache.get(default_allocator);
+	check(hit_again && (b[2][0] == 2), "writes to a result stay out of the cache");
+
+	cache.clear();
+	check(!cache.get(default_allocator).b, "cleared");
+	check((b[2][2] == 2) && (b[1][0] == 1), "copy outlives clear");
+}
+
+// The graph queries that go through the caches
+void check_matrix(test_rng& rng){
+	auto n = 2 + rng.below(30);
+	auto ref = random_graph(rng, n, 2, n);
+	auto mat = matrix_of(ref);
+	auto start = graph_node{u32(rng.below(n))};
+
+	auto closure = mat.transitive_closure(start);
+	auto levels = mat.reachability_matrix();
+	auto groups = mat.strongly_connected_subgraphs();
+
+	// Second calls are hits, then the results are scribbled over
+	auto closure_hit = mat.transitive_closure(start);
+	auto levels_hit = mat.reachability_matrix();
+	auto groups_hit = mat.strongly_connected_subgraphs();
+	check(same(view(closure_hit), view(closure)), "closure hit");
+	for(auto& p : closure_hit){ p.b = -7; }
+	for(auto row : levels_hit){ for(auto& v : row){ v = -7; } }
+	for(auto group : groups_hit){ for(auto& v : group){ v = graph_node{}; } }
+
+	auto closure_again = mat.transitive_closure(start);
+	auto levels_again = mat.reachability_matrix();
+	auto groups_again = mat.strongly_connected_subgraphs();
+	check(same(view(closure_again), view(closure)), "closure unchanged");
+	for(usize i = 0; i < levels.size(); i += 1){
+		check(same(view(levels_again[i]), view(levels[i])), "levels unchanged");
+	}
+	for(usize i = 0; i < groups.size(); i += 1){
+		check(same(view(groups_again[i]), view(groups[i])), "components unchanged");
+	}
+
+	// Toggling an edge out of start changes the level of its target without
+	// changing the size of any result, so a stale hit would go unnoticed
+	// without comparing the values
+	auto target = (start.id + 1 + rng.below(n - 1)) % n;
+	if(ref.has_edge(start.id, target)){
+		mat.disconnect(start, graph_node{u32(target)});
+		ref.set_edge(start.id, target, 0);
+	}
+	else {
+		mat.connect(start, graph_node{u32(target)});
+		ref.set_edge(start.id, target, 1);
+	}
+	check(matches(mat.transitive_closure(start), ref, start.id), "fresh closure after a change");
+	auto levels_fresh = mat.reachability_matrix();
+	for(usize a = 0; a < n; a += 1){
+		check(same(view(levels_fresh[a]), view(ref.levels(a))), "fresh levels after a change");
+	}
+
+	// A new node, results handed out earlier stay readable
+	auto grown = reference_graph(n + 1);
+	for(usize a = 0; a < n; a += 1){
+		for(usize b = 0; b < n; b += 1){ grown.set_edge(a, b, ref.weights[a * n + b]); }
+	}
+	grown.set_edge(n, start.id, 1);
+	mat.add_node(graph_node{u32(n)});
+	mat.connect(graph_node{u32(n)}, start);
+	check(matches(mat.transitive_closure(graph_node{u32(n)}), grown, n), "closure of the new node");
+	check(matches(mat.transitive_closure(start), grown, start.id), "fresh closure after a new node");
+	check(same(view(closure_again), view(closure)), "copy outlives the change");
+	check(levels_again.size() == n, "levels outlive the change");
+}
+
+int main(){
+	check_lru();
+	check_rows();
+
+	auto rng = test_rng{23};
+	for(usize round = 0; round < 40; round += 1){
+		check_matrix(rng);
+		arena.reset();
+	}
+
+	return check_report("query_cache");
+}
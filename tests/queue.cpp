@@ -0,0 +1,98 @@
+#include "testing.hpp"
+
+// x::queue behaves like a plain array with a moving head through pushes, pops,
+// growth while wrapped around and clears, and destroys what it constructs.
+
+// Counts the live instances, to catch elements destroyed twice or never
+struct tracked {
+	inline static isize live = 0;
+	u64 value = 0;
+
+	tracked(u64 v) : value{v} { live += 1; }
+	tracked(tracked const& t) : value{t.value} { live += 1; }
+	tracked(tracked&& t) : value{t.value} { live += 1; }
+	tracked& operator=(tracked const& t){ value = t.value; return *this; }
+	tracked& operator=(tracked&& t){ value = t.value; return *this; }
+	~tracked(){ live -= 1; }
+};
+
+template<typename T>
+void run(test_rng& rng, usize ops){
+	auto q = x::queue<T>(default_allocator, 1 + rng.below(8));
+	auto model = make_slice<u64>(default_allocator, ops * 4);
+	usize head = 0, tail = 0;
+	u64 counter = 0;
+
+	auto value_of = [](T const& v) -> u64 {
+		if constexpr(std::is_same_v<T, tracked>){ return v.value; }
+		else { return u64(v); }
+	};
+
+	for(usize i = 0; i < ops; i += 1){
+		auto op = rng.below(16);
+		if(op < 7){
+			q.push(T(counter));
+			model[tail++] = counter;
+			counter += 1;
+		}
+		else if(op < 8){
+			auto count = rng.below(6);
+			auto vals = make_slice<u64>(default_allocator, count);
+			for(auto& v : vals){
+				v = counter;
+				model[tail++] = counter;
+				counter += 1;
+			}
+			if constexpr(std::is_same_v<T, u64>){
+				q.push_span(vals);
+			}
+			else {
+				for(auto v : vals){ q.push(T(v)); }
+			}
+		}
+		else if(op < 13){
+			check(q.pop() == (head < tail), "pop result");
+			if(head < tail){ head += 1; }
+		}
+		else if(op < 14){
+			auto out = make_slice<u64>(default_allocator, rng.below(5));
+			if constexpr(std::is_same_v<T, u64>){
+				auto n = q.pop_span(out);
+				check(n == x::min(out.size(), tail - head), "pop_span count");
+				for(usize k = 0; k < n; k += 1){
+					check(out[k] == model[head + k], "pop_span order");
+				}
+				head += n;
+			}
+		}
+		else if(op < 15){
+			q.resize_capacity(q.size() + rng.below(40));
+		}
+		else if(rng.chance(1, 8)){
+			q.clear();
+			head = tail;
+		}
+
+		check(q.size() == tail - head, "size");
+		check(q.empty() == (head == tail), "empty");
+		check(q.capacity() >= q.size(), "capacity");
+		if(!q.empty()){
+			check(value_of(q.front()) == model[head], "front");
+			auto k = rng.below(q.size());
+			check(value_of(q[k]) == model[head + k], "indexing");
+		}
+	}
+}
+
+int main(){
+	auto rng = test_rng{14};
+
+	for(usize round = 0; round < 50; round += 1){
+		run<u64>(rng, 2000);
+		run<tracked>(rng, 2000);
+		check(tracked::live == 0, "every element destroyed");
+		arena.reset();
+	}
+
+	return check_report("queue");
+}
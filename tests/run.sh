@@ -0,0 +1,20 @@
+#!/usr/bin/env sh
+# Build and run every test, from the tests directory
+
+cxx='g++ -std=c++20'
+cxxflags='-Wall -Wextra -O2 -pthread -I../src'
+
+Run(){ echo "$@"; $@; }
+
+set -e
+
+mkdir -p bin
+for test in *.cpp; do
+	name="${test%.cpp}"
+	Run $cxx $cxxflags "$test" -o "bin/$name"
+	Run "./bin/$name"
+done
+
+# The arena is shared between threads, so also look for data races in it
+Run $cxx $cxxflags -g -fsanitize=thread arena.cpp -o bin/arena_tsan
+Run ./bin/arena_tsan
@@ -0,0 +1,195 @@
+#include "testing.hpp"
+
+// Graphs saved with the batch "save" command come back the same with "open",
+// empty ones included, and files that were cut short or damaged are refused.
+
+using snapshot_impl::header;
+
+// Arena copy of a builder's text
+slice<char> text_of(x::string_builder& b){
+	auto text = make_slice<char>(default_allocator, b.size());
+	x::mem_copy(text.raw_data(), b.build().raw_data(), b.size());
+	return text;
+}
+
+slice<char> line_of(char const* command, char const* path){
+	auto b = x::string_builder(default_allocator);
+	b.push(command);
+	b.push(path);
+	return text_of(b);
+}
+
+// Label of node i, some of them long
+slice<char> name_of(usize i){
+	auto b = x::string_builder(default_allocator);
+	b.push("n");
+	b.push_integer(i64(i));
+	if(i % 7 == 3){ b.push_repeat('x', 100 + i); }
+	return text_of(b);
+}
+
+slice<u8> read_file(char const* path){
+	auto file = std::fopen(path, "rb");
+	std::fseek(file, 0, SEEK_END);
+	auto size = usize(std::ftell(file));
+	std::fseek(file, 0, SEEK_SET);
+	auto bytes = make_slice<u8>(default_allocator, size);
+	check(std::fread(bytes.raw_data(), 1, size, file) == size, "read file");
+	std::fclose(file);
+	return bytes;
+}
+
+void write_file(char const* path, view<u8> bytes){
+	auto file = std::fopen(path, "wb");
+	check(std::fwrite(bytes.raw_data(), 1, bytes.size(), file) == bytes.size(), "write file");
+	std::fclose(file);
+}
+
+// Open a damaged copy of the snapshot in bytes
+snapshot_error open_damaged(char const* path, slice<u8> bytes, usize size){
+	write_file(path, view<u8>(bytes.raw_data(), size));
+	auto snap = graph_snapshot();
+	return snap.open(path);
+}
+
+void check_rejects(char const* path, char const* damaged_path){
+	auto bytes = read_file(path);
+	auto original = make_slice<u8>(default_allocator, bytes.size());
+	x::mem_copy(original.raw_data(), bytes.raw_data(), bytes.size());
+	auto restore = [&](){ x::mem_copy(bytes.raw_data(), original.raw_data(), bytes.size()); };
+
+	header h;
+	x::mem_copy(&h, bytes.raw_data(), sizeof(h));
+	auto h_ptr = reinterpret_cast<header*>(bytes.raw_data());
+
+	// Cut short anywhere inside of the header or a section
+	check(open_damaged(damaged_path, bytes, 0) != snapshot_error::None, "empty file");
+	check(open_damaged(damaged_path, bytes, sizeof(header) - 1) != snapshot_error::None, "cut header");
+	for(u32 id = 0; id < snapshot_impl::SectionCount; id += 1){
+		auto s = h.sections[id];
+		if(s.size == 0){ continue; }
+		check(open_damaged(damaged_path, bytes, s.offset + s.size - 1) == snapshot_error::BadLayout, "cut section");
+	}
+
+	bytes[0] ^= 0xff;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadMagic, "magic");
+	restore();
+
+	h_ptr->version += 1;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadVersion, "version");
+	restore();
+
+	h_ptr->byte_order = 0x04030201;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadByteOrder, "byte order");
+	restore();
+
+	h_ptr->node_count += 1;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadLayout, "node count");
+	restore();
+
+	h_ptr->sections[snapshot_impl::Neighbors].offset += 8;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadLayout, "misaligned section");
+	restore();
+
+	// Last offset disagreeing with the edge count
+	auto last = h.sections[snapshot_impl::Offsets].offset + h.node_count * sizeof(u64);
+	bytes[last] ^= 1;
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::BadLayout, "offsets");
+	restore();
+
+	check(open_damaged(damaged_path, bytes, bytes.size()) == snapshot_error::None, "undamaged copy");
+}
+
+int main(){
+	char path[] = "/tmp/snapshot_XXXXXX";
+	char damaged_path[] = "/tmp/snapshot_damaged_XXXXXX";
+	close(mkstemp(path));
+	close(mkstemp(damaged_path));
+
+	auto rng = test_rng{16};
+	for(usize round = 0; round < 30; round += 1){
+		auto n = rng.below(70);
+		auto ref = random_graph(rng, n, 1 + rng.below(4), 2 * n + 1);
+
+		auto saver = batch_context();
+		auto nodes = make_slice<graph_node>(default_allocator, n);
+		for(usize i = 0; i < n; i += 1){
+			auto name = name_of(i);
+			nodes[i] = saver.ui.node_named(name, true);
+		}
+		saver.ui.mat = connectivity_matrix(nodes);
+		for(usize a = 0; a < n; a += 1){
+			for(usize b = 0; b < n; b += 1){
+				if(ref.has_edge(a, b)){ saver.ui.mat.connect(nodes[a], nodes[b]); }
+			}
+		}
+		saver.run_line(line_of("save ", path));
+		check(saver.error_count == 0, "save");
+
+		// Reopened through the batch command, labels and edges are the same
+		auto opener = batch_context();
+		opener.run_line(line_of("open ", path));
+		check(opener.error_count == 0, "open");
+		check(opener.ui.mat.node_count() == n, "node count");
+		check(opener.ui.mat.edge_count() == ref.edge_count(), "edge count");
+		auto opened = make_slice<graph_node>(default_allocator, n);
+		for(usize i = 0; i < n; i += 1){
+			auto name = name_of(i);
+			opened[i] = opener.ui.node_named(name, false);
+			check(opener.ui.mat.index_of(opened[i]) >= 0, "label");
+		}
+		for(usize a = 0; a < n; a += 1){
+			for(usize b = 0; b < n; b += 1){
+				check(opener.ui.mat.connected(opened[a], opened[b]) == ref.has_edge(a, b), "edges");
+			}
+		}
+
+		// The optional sections, read straight from the snapshot
+		check(x::error_ok(csr_graph(saver.ui.mat).write_snapshot(path, &saver.ui.labels, true)), "write with closure");
+		auto snap = graph_snapshot();
+		check(snap.open(path) == snapshot_error::None, "open with closure");
+		check(snap.has_labels(), "labels");
+		check((n == 0) || (snap.has_components() && snap.has_reachability()), "optional sections");
+		auto [comp, comp_count] = tarjan_components(saver.ui.mat);
+		check(snap.component_count() == comp_count, "component count");
+		for(usize a = 0; a < n; a += 1){
+			auto name = name_of(a);
+			check(snap.index_of(view<u8>(reinterpret_cast<u8 const*>(name.raw_data()), name.size())) == isize(a), "label lookup");
+			for(usize b = 0; b < n; b += 1){
+				check(snap.reachable(a, b) == ((a != b) && ref.reaches(a, b)), "reachability");
+				check((snap.component(a) == snap.component(b)) == (comp[a] == comp[b]), "components");
+			}
+		}
+		snap.close();
+
+		if(n > 0){ check_rejects(path, damaged_path); }
+		arena.reset();
+	}
+
+	// A csr_adjacency without nodes has no offsets to write, it still makes a
+	// snapshot of an empty graph, with and without the optional sections
+	auto empty = csr_adjacency(default_allocator);
+	auto no_label = [](usize) -> view<u8> { return {}; };
+	auto no_closure = bit_matrix(default_allocator);
+	check(write_snapshot(path, empty, nullptr, {}, 0, nullptr) == snapshot_error::None, "write empty");
+	auto empty_snap = graph_snapshot();
+	check(empty_snap.open(path) == snapshot_error::None, "open empty");
+	check((empty_snap.size() == 0) && (empty_snap.edge_count() == 0), "empty graph");
+	check(write_snapshot(path, empty, no_label, {}, 0, &no_closure) == snapshot_error::None, "write empty with sections");
+	check(empty_snap.open(path) == snapshot_error::None, "open empty with sections");
+	check((empty_snap.size() == 0) && (empty_snap.index_of({}) < 0), "empty graph with sections");
+	empty_snap.close();
+	auto empty_opener = batch_context();
+	empty_opener.run_line(line_of("open ", path));
+	check((empty_opener.error_count == 0) && (empty_opener.ui.mat.node_count() == 0), "open empty in batch");
+
+	// Missing files
+	auto batch = batch_context();
+	batch.run_line(line_of("open ", "/nonexistent/graph.snap"));
+	batch.run_line(line_of("save ", "/nonexistent/graph.snap"));
+	check(batch.error_count == 2, "missing files");
+
+	std::remove(path);
+	std::remove(damaged_path);
+	return check_report("snapshot");
+}
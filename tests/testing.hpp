@@ -0,0 +1,191 @@
+#ifndef _testing_hpp_include_
+#define _testing_hpp_include_
+
+// Every test includes the whole program, without its main()
+#define GRAPH_NO_MAIN
+#include "graph.cpp"
+
+// Check results against plain reference implementations: a dense boolean
+// matrix searched the simplest possible way, which is what the program did
+// before any of the faster representations existed.
+
+inline usize check_failures = 0;
+
+inline
+bool check(bool ok, char const* what, Caller_Location){
+	if(!ok){
+		check_failures += 1;
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", caller_location.file_name(), int(caller_location.line()), what);
+	}
+	return ok;
+}
+
+// Exit code of a test program
+inline
+int check_report(char const* name){
+	if(check_failures > 0){
+		std::printf("%s: %zu failed checks\n", name, check_failures);
+		return 1;
+	}
+	std::printf("%s: ok\n", name);
+	return 0;
+}
+
+// Deterministic splitmix64 generator
+struct test_rng {
+	u64 state;
+
+	u64 next(){
+		state += 0x9e3779b97f4a7c15;
+		auto z = state;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	// In [0, n)
+	usize below(usize n){
+		return usize(next() % u64(n));
+	}
+
+	// True with a chance of num/den
+	bool chance(usize num, usize den){
+		return below(den) < num;
+	}
+};
+
+// Dense adjacency with weights, 0 when there is no edge
+struct reference_graph {
+	usize n = 0;
+	slice<u32> weights;
+
+	bool has_edge(usize a, usize b) const {
+		return weights[a * n + b] != 0;
+	}
+
+	void set_edge(usize a, usize b, u32 w){
+		weights[a * n + b] = w;
+	}
+
+	usize edge_count() const {
+		usize count = 0;
+		for(auto w : weights){ count += (w != 0) ? 1 : 0; }
+		return count;
+	}
+
+	// Steps from start to every node, -1 when unreachable
+	slice<i32> levels(usize start) const {
+		auto level = make_slice<i32>(default_allocator, n);
+		for(auto& l : level){ l = -1; }
+		auto queue = make_slice<usize>(default_allocator, n);
+		usize head = 0, tail = 0;
+		level[start] = 0;
+		queue[tail++] = start;
+		while(head < tail){
+			auto u = queue[head++];
+			for(usize v = 0; v < n; v += 1){
+				if(has_edge(u, v) && (level[v] < 0)){
+					level[v] = level[u] + 1;
+					queue[tail++] = v;
+				}
+			}
+		}
+		return level;
+	}
+
+	// Nodes in the order a queue reaches them from start, neighbours in
+	// ascending order
+	dynamic_array<usize> visiting_order(usize start) const {
+		auto seen = make_slice<bool>(default_allocator, n);
+		auto order = dynamic_array<usize>(default_allocator, n + 1);
+		seen[start] = true;
+		order.append(start);
+		for(usize head = 0; head < order.size(); head += 1){
+			auto u = order[head];
+			for(usize v = 0; v < n; v += 1){
+				if(has_edge(u, v) && !seen[v]){
+					seen[v] = true;
+					order.append(v);
+				}
+			}
+		}
+		return order;
+	}
+
+	bool reaches(usize a, usize b) const {
+		return levels(a)[b] >= 0;
+	}
+
+	// Dijkstra without a heap, O(V^2)
+	slice<i64> distances(usize start) const {
+		auto dist = make_slice<i64>(default_allocator, n);
+		auto done = make_slice<bool>(default_allocator, n);
+		for(auto& d : dist){ d = -1; }
+		dist[start] = 0;
+		while(1){
+			isize best = -1;
+			for(usize v = 0; v < n; v += 1){
+				if(!done[v] && (dist[v] >= 0) && ((best < 0) || (dist[v] < dist[best]))){ best = v; }
+			}
+			if(best < 0){ break; }
+			done[best] = true;
+			for(usize v = 0; v < n; v += 1){
+				if(!has_edge(best, v)){ continue; }
+				auto nd = dist[best] + i64(weights[best * n + v]);
+				if((dist[v] < 0) || (nd < dist[v])){ dist[v] = nd; }
+			}
+		}
+		return dist;
+	}
+
+	// Whether path is a walk along edges from a to b
+	bool valid_path(view<usize> path, usize a, usize b) const {
+		if(path.size() == 0){ return false; }
+		if((path[0] != a) || (path[path.size() - 1] != b)){ return false; }
+		for(usize i = 1; i < path.size(); i += 1){
+			if(!has_edge(path[i - 1], path[i])){ return false; }
+		}
+		return true;
+	}
+
+	reference_graph(usize n)
+		: n{n}, weights{make_slice<u32>(default_allocator, n * n)} {}
+};
+
+// Random graph on n nodes where each edge exists with a chance of num/den,
+// weights go from 1 to max_weight
+inline
+reference_graph random_graph(test_rng& rng, usize n, usize num, usize den, u32 max_weight = 1){
+	auto g = reference_graph(n);
+	for(usize a = 0; a < n; a += 1){
+		for(usize b = 0; b < n; b += 1){
+			if(rng.chance(num, den)){ g.set_edge(a, b, 1 + u32(rng.below(max_weight))); }
+		}
+	}
+	return g;
+}
+
+// Nodes with the ids 0 to n-1
+inline
+slice<graph_node> numbered_nodes(usize n){
+	auto nodes = make_slice<graph_node>(default_allocator, n);
+	for(usize i = 0; i < n; i += 1){ nodes[i] = graph_node{u32(i)}; }
+	return nodes;
+}
+
+// Matrix holding the same graph, node i has id i
+inline
+connectivity_matrix matrix_of(reference_graph const& ref){
+	auto mat = connectivity_matrix(numbered_nodes(ref.n));
+	for(usize a = 0; a < ref.n; a += 1){
+		for(usize b = 0; b < ref.n; b += 1){
+			if(!ref.has_edge(a, b)){ continue; }
+			auto w = ref.weights[a * ref.n + b];
+			if(w == 1){ mat.connect(graph_node{u32(a)}, graph_node{u32(b)}); }
+			else { mat.connect_weighted(graph_node{u32(a)}, graph_node{u32(b)}, w); }
+		}
+	}
+	return mat;
+}
+
+#endif /* Include guard */
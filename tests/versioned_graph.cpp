@@ -0,0 +1,144 @@
+#include "testing.hpp"
+
+// Readers of a versioned_graph see whole versions while the writer keeps
+// publishing, and sharing a matrix publishes exactly its current nodes and
+// edges, removals included.
+
+// Edge set of the version numbered v, over nodes 0..node_count-1: a ring,
+// plus one chord that moves with v
+constexpr usize node_count = 150;
+
+bool expected_edge(u64 v, usize a, usize b){
+	return (b == (a + 1) % node_count) || ((a == v % node_count) && (b == (a * 7 + v) % node_count));
+}
+
+// Every bit of the pinned version agrees with its number and the transpose
+bool consistent(versioned_graph::version const& g){
+	if(g.number == 0){ return g.node_count() == 0; }
+	if(g.node_count() != node_count){ return false; }
+
+	usize edges = 0;
+	for(usize a = 0; a < g.size(); a += 1){
+		auto id_a = g.node_id(a);
+		bool ok = true;
+		g.for_each_neighbor(a, [&](usize b){
+			edges += 1;
+			ok = ok && expected_edge(g.number, id_a, g.node_id(b));
+			ok = ok && ((g.in_row(b)[a / 64] >> (a % 64)) & 1);
+		});
+		if(!ok){ return false; }
+	}
+	return edges == g.edge_count();
+}
+
+void concurrent_readers(){
+	auto shared = versioned_graph(storage_allocator);
+	std::atomic<bool> done{false};
+	std::atomic<usize> failures{0};
+	std::atomic<usize> reads{0};
+
+	// Readers come and go, more of them over time than there are slots
+	auto reader = [&](){
+		while(!done.load()){
+			auto slot = shared.register_reader();
+			if(slot == usize(versioned_graph::none)){ continue; }
+			for(usize i = 0; i < 20; i += 1){
+				auto pin = shared.read(slot);
+				if(!consistent(*pin)){ failures.fetch_add(1); }
+				reads.fetch_add(1);
+			}
+			shared.unregister_reader(slot);
+		}
+	};
+
+	auto threads = dynamic_array<std::thread>(storage_allocator);
+	for(usize i = 0; i < 4; i += 1){
+		threads.append(std::thread(reader));
+	}
+
+	// The writer rebuilds the expected graph of the next number each time
+	auto mat = connectivity_matrix(numbered_nodes(node_count));
+	for(u64 v = 1; v <= 300; v += 1){
+		for(usize a = 0; a < node_count; a += 1){
+			for(usize b = 0; b < node_count; b += 1){
+				auto want = expected_edge(v, a, b);
+				if(mat.connected(graph_node{u32(a)}, graph_node{u32(b)}) != want){
+					if(want){ mat.connect(graph_node{u32(a)}, graph_node{u32(b)}); }
+					else { mat.disconnect(graph_node{u32(a)}, graph_node{u32(b)}); }
+				}
+			}
+		}
+		check(mat.share(shared) == v, "version number");
+	}
+
+	done.store(true);
+	for(auto& t : threads){ t.join(); }
+
+	check(failures.load() == 0, "readers saw whole versions");
+	check(reads.load() > 0, "readers ran");
+	shared.reclaim();
+	check(shared.retired_count() == 0, "every old version freed");
+}
+
+// The shared graph, by node id
+bool shared_has_edge(versioned_graph::version const& g, u32 a, u32 b){
+	auto from = g.index_of(a);
+	auto to = g.index_of(b);
+	return (from >= 0) && (to >= 0) && g.connected(usize(from), usize(to));
+}
+
+void share_removals(test_rng& rng){
+	auto shared = versioned_graph(storage_allocator);
+	auto reader = shared.register_reader();
+	auto n = 2 + rng.below(100);
+	auto mat = matrix_of(random_graph(rng, n, 2, n));
+
+	for(usize step = 0; step < 20; step += 1){
+		// Random edges come and go, nodes get deleted and come back
+		for(usize i = 0; i < n; i += 1){
+			auto a = graph_node{u32(rng.below(n))};
+			auto b = graph_node{u32(rng.below(n))};
+			if(rng.chance(1, 2)){ mat.connect(a, b); } else { mat.disconnect(a, b); }
+		}
+		if(rng.chance(1, 3)){ mat.del_node(graph_node{u32(rng.below(n))}); }
+		if(rng.chance(1, 3)){ mat.add_node(graph_node{u32(rng.below(n))}); }
+		mat.share(shared);
+
+		auto pin = shared.read(reader);
+		check(pin->node_count() == mat.node_count(), "shared node count");
+		check(pin->edge_count() == mat.edge_count(), "shared edge count");
+		for(u32 a = 0; a < n; a += 1){
+			check((pin->index_of(a) >= 0) == (mat.index_of(graph_node{a}) >= 0), "shared nodes");
+			for(u32 b = 0; b < n; b += 1){
+				check(shared_has_edge(*pin, a, b) == mat.connected(graph_node{a}, graph_node{b}), "shared edges");
+			}
+		}
+	}
+	shared.unregister_reader(reader);
+}
+
+void reader_slots(){
+	auto shared = versioned_graph(storage_allocator);
+	usize slots[versioned_graph::max_readers];
+	for(auto& s : slots){
+		s = shared.register_reader();
+		check(s < versioned_graph::max_readers, "slot handed out");
+	}
+	check(shared.register_reader() == usize(versioned_graph::none), "all slots taken");
+
+	shared.unregister_reader(slots[5]);
+	check(shared.register_reader() == slots[5], "released slot reused");
+}
+
+int main(){
+	concurrent_readers();
+	reader_slots();
+
+	auto rng = test_rng{24};
+	for(usize round = 0; round < 20; round += 1){
+		share_removals(rng);
+		arena.reset();
+	}
+
+	return check_report("versioned_graph");
+}